@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstddef>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <vector>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Allocation policies for the storage of Tensor.
+// A policy provides static allocate(bytes) and deallocate(ptr) functions.
+// The returned memory is not initialized.
+namespace memory {
+
+	// Alignment of all allocations; enough for aligned AVX-512 loads.
+	constexpr std::size_t ALIGNMENT = 64;
+
+	struct AlignedAllocator
+	{
+		static void* allocate(std::size_t _bytes)
+		{
+			// aligned_alloc requires the size to be a multiple of the alignment
+			const std::size_t size = std::max(ALIGNMENT, (_bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+#if defined(_MSC_VER)
+			void* ptr = _aligned_malloc(size, ALIGNMENT);
+#else
+			void* ptr = std::aligned_alloc(ALIGNMENT, size);
+#endif
+			if (!ptr) throw std::bad_alloc();
+			return ptr;
+		}
+
+		static void deallocate(void* _ptr) noexcept
+		{
+#if defined(_MSC_VER)
+			_aligned_free(_ptr);
+#else
+			std::free(_ptr);
+#endif
+		}
+	};
+
+	// Backs large allocations with transparent huge pages on Linux to reduce TLB misses.
+	// Elsewhere this is equivalent to AlignedAllocator.
+	struct HugePageAllocator
+	{
+		static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+		static void* allocate(std::size_t _bytes)
+		{
+#if defined(__linux__)
+			if (_bytes >= HUGE_PAGE_SIZE)
+			{
+				const std::size_t size = (_bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+				void* ptr = std::aligned_alloc(HUGE_PAGE_SIZE, size);
+				if (!ptr) throw std::bad_alloc();
+				// only a hint, failure is not an error
+				madvise(ptr, size, MADV_HUGEPAGE);
+				return ptr;
+			}
+#endif
+			return AlignedAllocator::allocate(_bytes);
+		}
+
+		static void deallocate(void* _ptr) noexcept
+		{
+			AlignedAllocator::deallocate(_ptr);
+		}
+	};
+
+	// Monotonic buffer for short-lived tensors.
+	// While an Arena exists, ArenaAllocator serves all allocations of the thread from it.
+	// Memory is only released by reset() or when the arena is destroyed.
+	class Arena
+	{
+	public:
+		explicit Arena(std::size_t _chunkSize = std::size_t(64) << 20)
+			: m_chunkSize(_chunkSize), m_chunk(0), m_used(0), m_previous(s_current)
+		{
+			s_current = this;
+		}
+
+		~Arena()
+		{
+			assert(s_current == this);
+			s_current = m_previous;
+		}
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(std::size_t _bytes)
+		{
+			const std::size_t size = (_bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+			while (m_chunk < m_chunks.size() && m_used + size > m_chunks[m_chunk].size)
+			{
+				++m_chunk;
+				m_used = 0;
+			}
+			if (m_chunk == m_chunks.size())
+			{
+				const std::size_t chunkSize = std::max(m_chunkSize, size);
+				m_chunks.push_back({ Buffer(static_cast<char*>(AlignedAllocator::allocate(chunkSize))),
+					chunkSize });
+				m_used = 0;
+			}
+
+			void* ptr = m_chunks[m_chunk].data.get() + m_used;
+			m_used += size;
+			return ptr;
+		}
+
+		// Invalidate all allocations while keeping the memory for reuse.
+		void reset() noexcept
+		{
+			m_chunk = 0;
+			m_used = 0;
+		}
+
+		static Arena* current() noexcept { return s_current; }
+	private:
+		struct Deleter
+		{
+			void operator()(char* _ptr) const noexcept { AlignedAllocator::deallocate(_ptr); }
+		};
+		using Buffer = std::unique_ptr<char[], Deleter>;
+		struct Chunk
+		{
+			Buffer data;
+			std::size_t size;
+		};
+
+		std::size_t m_chunkSize;
+		std::vector<Chunk> m_chunks;
+		std::size_t m_chunk;
+		std::size_t m_used;
+		Arena* m_previous;
+
+		inline static thread_local Arena* s_current = nullptr;
+	};
+
+	// Allocates from the innermost Arena of the calling thread.
+	struct ArenaAllocator
+	{
+		static void* allocate(std::size_t _bytes)
+		{
+			assert(Arena::current() && "ArenaAllocator requires an active Arena.");
+			return Arena::current()->allocate(_bytes);
+		}
+
+		static void deallocate(void*) noexcept {}
+	};
+
+	// Number of bytes required to advance _offset to the next multiple of ALIGNMENT.
+	inline std::size_t alignmentPadding(std::size_t _offset) noexcept
+	{
+		return (ALIGNMENT - _offset % ALIGNMENT) % ALIGNMENT;
+	}
+
+	// Deleter for unique_ptr which returns the memory to the Allocator.
+	template<typename Allocator>
+	struct Deallocate
+	{
+		// If set, the memory is external and only this reference is released.
+		mutable std::shared_ptr<const void> owner;
+
+		template<typename T>
+		void operator()(T* _ptr) const noexcept
+		{
+			if (owner)
+				owner.reset();
+			else
+				Allocator::deallocate(_ptr);
+		}
+	};
+}
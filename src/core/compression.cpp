@@ -1,13 +1,93 @@
 #include "compression.hpp"
 #include "core/hosvd.hpp"
+#include "core/incremental.hpp"
+#include "core/ratedistortion.hpp"
+#include "utils/boundedqueue.hpp"
+#include "utils/mappedfile.hpp"
+#include "video/videowriter.hpp"
+#include <algorithm>
 #include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <omp.h>
+#include <thread>
 
 namespace compression {
 
+	namespace {
+		// Written at the start of a file to identify the decomposition it contains.
+		using FormatTag = std::array<char, 4>;
+		constexpr FormatTag HOSVD_TAG = { 'T', 'C', 'H', 'O' };
+		constexpr FormatTag TT_TAG = { 'T', 'C', 'T', 'T' };
+
+		// Decodes blocks on a separate thread while the frames of the previous blocks are encoded,
+		// so that only a few blocks are held in memory.
+		// If decoding or encoding fails, the unfinished file is removed.
+		// @param _decodeBlock Appends the frames of block i to a Video as _decodeBlock(i, video).
+		// @param _queueSize Number of decoded blocks which may wait for the encoder.
+		template<typename DecodeBlock>
+		void decodeToFile(const std::string& _fileName, size_t _numBlocks, int _width, int _height,
+			Video::FrameRate _frameRate, size_t _queueSize, DecodeBlock _decodeBlock)
+		{
+			BoundedQueue<Video> queue(_queueSize);
+			std::exception_ptr producerError;
+			// a new thread starts with the default OpenMP settings instead of the caller's
+			const int numThreads = omp_get_max_threads();
+			std::thread producer([&]()
+				{
+					omp_set_num_threads(numThreads);
+					try
+					{
+						for (size_t i = 0; i < _numBlocks; ++i)
+						{
+							Video block(_width, _height, _frameRate);
+							_decodeBlock(i, block);
+							if (!queue.push(std::move(block)))
+								break;
+						}
+					}
+					catch (...)
+					{
+						producerError = std::current_exception();
+					}
+					queue.close();
+				});
+
+			try
+			{
+				VideoWriter writer(_fileName, _width, _height, _frameRate);
+				while (auto block = queue.pop())
+					writer.write(*block);
+				producer.join();
+				if (producerError)
+					std::rethrow_exception(producerError);
+				writer.close();
+			}
+			catch (...)
+			{
+				// stops the producer
+				queue.close();
+				if (producer.joinable())
+					producer.join();
+				std::remove(_fileName.c_str());
+				throw;
+			}
+		}
+	}
+
 	template<typename PixelFormat>
 	HOSVDCompressor<PixelFormat>::HOSVDCompressor(const PixelFormat& _space)
 		: m_pixelFormat(_space),
 		m_numFramesPerBlock(24),
+		m_reducedPrecision(false),
+		m_oversampling(-1),
+		m_maxBytes(0),
+		m_refinementIterations(0),
+		m_minImprovement(1e-3),
+		m_incrementalFrames(0),
+		m_warmStartIterations(-1),
+		m_downscale(1),
 		m_frameRate{1,24},
 		m_truncation(new truncation::TruncationAdaptor(truncation::Zero()))
 	{}
@@ -22,18 +102,78 @@ namespace compression {
 		const size_t numBlocks = _video.getNumFrames() / numFramesPerBlock
 			+ (_video.getNumFrames() % numFramesPerBlock != 0);
 
+		m_basis.clear();
+		m_core.clear();
 		m_basis.reserve(numBlocks);
 		m_core.reserve(numBlocks);
+		m_modeOrders.clear();
+		m_modeOrders.reserve(numBlocks);
+		m_refinementStats.clear();
+		m_warmStartStats = WarmStartStats();
 
 		constexpr int numProgressSteps = 10;
 		int progress = 0;
 
 		for (size_t i = 0; i < numBlocks; ++i)
 		{
-			const int begin = static_cast<int>(i * numFramesPerBlock);
-			const auto tensor = _video.asTensor(begin, numFramesPerBlock, m_pixelFormat);
-			auto UC = hosvdInterlaced(tensor, *m_truncation);
-			m_basis.emplace_back(std::move(std::get<0>(UC)));
+			const size_t begin = i * numFramesPerBlock;
+			auto decompose = [&](const auto& _tensor)
+			{
+				// the ranks are only known in advance for rank truncation; otherwise those of
+				// the previous block are a good estimate for consecutive blocks
+				std::array<int, 4> ranks = _tensor.size();
+				for (int k = 0; k < 4 && i > 0; ++k)
+					ranks[k] = std::min(ranks[k], m_basis[i - 1][k].size()[1]);
+				const std::array<int, 4> order = m_rank ? optimalModeOrder(_tensor.size(), *m_rank)
+					: optimalModeOrder(_tensor.size(), ranks);
+				m_modeOrders.push_back(order);
+				auto truncate = [&](const auto& _truncate)
+				{
+					if (m_warmStartIterations < 0 || i == 0)
+						return hosvdInterlaced(_tensor, _truncate, order);
+					// the temporal basis of the previous block belongs to other frames
+					const auto previous = basis(i - 1);
+					const std::array<MatrixMap, 4> initial{ previous[0], previous[1], previous[2],
+						MatrixMap(nullptr, 0, 0) };
+					return hosvdWarmStarted(_tensor, _truncate, initial, order, m_warmStartIterations,
+						&m_warmStartStats);
+				};
+				// the error bound for a target PSNR depends on the norm of the block
+				auto UC = m_targetPSNR
+					? truncate(truncation::RelativeError::fromPSNR(*m_targetPSNR, _tensor.expr().squaredNorm(),
+						_tensor.numElements()))
+					: (m_rank && m_oversampling >= 0
+						? hosvdRandomized(_tensor, *m_rank, m_oversampling, 1, order)
+						: truncate(*m_truncation));
+				if (m_refinementIterations > 0)
+					m_refinementStats.push_back(hooi(_tensor, std::get<0>(UC), std::get<1>(UC),
+						m_refinementIterations, m_minImprovement));
+				return UC;
+			};
+			// feeds the block in small batches of frames so that it is never materialized
+			auto decomposeIncremental = [&](auto _scalar)
+			{
+				using Scalar = decltype(_scalar);
+				IncrementalTucker<float, 4, truncation::AbstractTruncation> tucker(*m_truncation);
+				const size_t end = std::min(begin + numFramesPerBlock, _video.getNumFrames());
+				for (size_t frame = begin; frame < end; frame += m_incrementalFrames)
+				{
+					tucker.add(_video.asTensor<Scalar>(frame, std::min(m_incrementalFrames, end - frame),
+						m_pixelFormat));
+				}
+				return tucker.finalize();
+			};
+			auto UC = m_incrementalFrames > 0
+				? (m_reducedPrecision ? decomposeIncremental(Eigen::half()) : decomposeIncremental(float()))
+				: (m_reducedPrecision
+					? decompose(_video.asTensor<Eigen::half>(begin, numFramesPerBlock, m_pixelFormat))
+					: decompose(_video.asTensor(begin, numFramesPerBlock, m_pixelFormat)));
+			auto& basis = m_basis.emplace_back();
+			for (size_t k = 0; k < basis.size(); ++k)
+			{
+				const auto& U = std::get<0>(UC)[k];
+				basis[k] = BasisMatrix({ static_cast<int>(U.rows()), static_cast<int>(U.cols()) }, U.data());
+			}
 			m_core.emplace_back(std::move(std::get<1>(UC)));
 
 			const int actualProgress = static_cast<int>(static_cast<float>(i+1) / numBlocks * numProgressSteps);
@@ -41,23 +181,162 @@ namespace compression {
 				std::cout << "#";
 		}
 		std::cout << "\n";
+
+		if (m_maxBytes > 0)
+			truncateToBudget();
 	}
 
 	template<typename PixelFormat>
-	Video HOSVDCompressor<PixelFormat>::decode() const
+	void HOSVDCompressor<PixelFormat>::truncateToBudget()
 	{
-		Tensor<float, 4> fullTensor(multilinearProduct(m_basis[0], m_core[0]));
-		for (size_t i = 1; i < m_basis.size(); ++i)
+		// the energy of a slice of the core is what removing it discards; for an all-orthogonal
+		// core these are the squared singular values of the mode
+		std::vector<BlockSpectrum<4>> spectra(m_core.size());
+		TensorType buffer;
+		for (size_t i = 0; i < m_core.size(); ++i)
 		{
-			fullTensor.append(multilinearProduct(m_basis[i], m_core[i]));
+			for (int k = 0; k < 4; ++k)
+			{
+				const int rows = m_basis[i][k].size()[0];
+				const Eigen::VectorXd energy = m_core[i].flatten(k).rowwise().squaredNorm().template cast<double>();
+				spectra[i].size[k] = rows;
+
+				// allocateRanks drops the trailing slices, so they have to be the weakest ones;
+				// this does not hold after a warm start, an incremental update or a refinement
+				std::vector<int> order(energy.size());
+				std::iota(order.begin(), order.end(), 0);
+				std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return energy[a] > energy[b]; });
+				if (std::is_sorted(order.begin(), order.end()))
+				{
+					spectra[i].energy[k] = energy;
+					continue;
+				}
+				// slice j of the permuted core is slice order[j] of the old one
+				const int rank = static_cast<int>(order.size());
+				Eigen::MatrixX<float> permutation = Eigen::MatrixX<float>::Zero(rank, rank);
+				for (int j = 0; j < rank; ++j)
+					permutation(j, order[j]) = 1.f;
+				const Eigen::MatrixX<float> U = m_basis[i][k].mat() * permutation.transpose();
+				m_basis[i][k] = BasisMatrix({ rows, rank }, U.data());
+				modeProduct(permutation, m_core[i], buffer, k);
+				std::swap(m_core[i], buffer);
+				spectra[i].energy[k] = permutation.cast<double>() * energy;
+			}
+		}
+
+		// upper bound of the storage which does not depend on the ranks, see save()
+		constexpr size_t fileHeader = sizeof(FormatTag) + sizeof(Video::FrameRate) + sizeof(int);
+		constexpr size_t blockHeader = sizeof(Video::FrameRate) + 4 * sizeof(int)
+			+ 4 * 2 * sizeof(Eigen::Index) + 5 * (memory::ALIGNMENT - 1);
+		if (m_maxBytes < fileHeader)
+			throw std::string("The decomposition does not fit into " + std::to_string(m_maxBytes) + " bytes.");
+		const auto ranks = allocateRanks(spectra, m_maxBytes - fileHeader, blockHeader);
+
+		for (size_t i = 0; i < m_core.size(); ++i)
+		{
+			// the leading columns of a column-major matrix are contiguous
+			for (int k = 0; k < 4; ++k)
+				m_basis[i][k] = BasisMatrix({ spectra[i].size[k], ranks[i][k] }, m_basis[i][k].data());
+			auto core = std::as_const(m_core[i]).view();
+			for (int k = 0; k < 4; ++k)
+				core = core.slice(k, 0, ranks[i][k]);
+			m_core[i] = TensorType(core);
 		}
-		return Video(fullTensor, m_frameRate, m_pixelFormat);
+	}
+
+	template<typename PixelFormat>
+	void HOSVDCompressor<PixelFormat>::decodeBlock(size_t _block, Video& _video) const
+	{
+		// the block is expanded in tiles of image rows, each finished by the temporal product
+		// while it is quantized, so only one tile per thread is stored as floats
+		const auto U = outputBasis(_block);
+		const int rowsPerTile = std::clamp(static_cast<int>(details::PARALLEL_CHUNK / (3 * U[1].rows())),
+			1, static_cast<int>(U[2].rows()));
+		// order of the spatial products for one tile; the temporal product is always last
+		const std::array<Eigen::MatrixX<float>, 3> tileBasis{ U[0], U[1], U[2].topRows(rowsPerTile) };
+		const std::array<int, 3> order = optimalProductOrder(tileBasis);
+
+		// products before the one with the height mode are the same for all tiles
+		TensorType shared;
+		TensorType buffer;
+		size_t numShared = 0;
+		for (; order[numShared] != 2; ++numShared)
+		{
+			const int k = order[numShared];
+			modeProduct(U[k], numShared ? std::as_const(shared).view() : m_core[_block].view(), buffer, k);
+			std::swap(shared, buffer);
+		}
+		const TensorType& partial = numShared ? shared : m_core[_block];
+
+		_video.appendProduct(rowsPerTile, [&](int _y, int _numRows)
+			{
+				TensorType tile;
+				TensorType tileBuffer;
+				modeProduct(U[2].middleRows(_y, _numRows), partial, tile, 2);
+				for (size_t i = numShared + 1; i < order.size(); ++i)
+				{
+					modeProduct(U[order[i]], tile, tileBuffer, order[i]);
+					std::swap(tile, tileBuffer);
+				}
+				return tile;
+			}, U[3], m_pixelFormat);
+	}
+
+	template<typename PixelFormat>
+	Video HOSVDCompressor<PixelFormat>::decode() const
+	{
+		if (m_basis.empty())
+			throw std::string("Nothing to decode.");
+		const auto U = outputBasis(0);
+		Video video(static_cast<int>(U[1].rows()), static_cast<int>(U[2].rows()), m_frameRate);
+		for (size_t i = 0; i < m_basis.size(); ++i)
+			decodeBlock(i, video);
+		return video;
+	}
+
+	template<typename PixelFormat>
+	void HOSVDCompressor<PixelFormat>::decode(const std::string& _fileName) const
+	{
+		if (m_basis.empty())
+			throw std::string("Nothing to decode.");
+		const auto U = outputBasis(0);
+		decodeToFile(_fileName, m_basis.size(), static_cast<int>(U[1].rows()), static_cast<int>(U[2].rows()),
+			m_frameRate, 1,
+			[this](size_t _block, Video& _video) { decodeBlock(_block, _video); });
+	}
+
+	template<typename PixelFormat>
+	Video HOSVDCompressor<PixelFormat>::decodeFrame(size_t _frame) const
+	{
+		size_t block = 0;
+		for (; block < m_basis.size() && _frame >= static_cast<size_t>(m_basis[block][3].size()[0]); ++block)
+			_frame -= m_basis[block][3].size()[0];
+		if (block == m_basis.size())
+			throw std::string("Frame index out of range.");
+
+		// the row of the temporal basis combines the slices of the core into the frame
+		auto U = outputBasis(block);
+		U[3] = U[3].row(_frame).eval();
+		return Video(multilinearProduct(U, m_core[block]), m_frameRate, m_pixelFormat);
+	}
+
+	template<typename PixelFormat>
+	std::array<Eigen::MatrixX<float>, 4> HOSVDCompressor<PixelFormat>::outputBasis(size_t _block) const
+	{
+		const auto U = basis(_block);
+		const std::array<int, 4> region = details::decodeRegion(m_region, m_downscale,
+			static_cast<int>(U[1].rows()), static_cast<int>(U[2].rows()));
+
+		// rows of the spatial bases correspond to pixel columns and rows
+		return { U[0], details::resampleRows(U[1], region[0], region[2], m_downscale),
+			details::resampleRows(U[2], region[1], region[3], m_downscale), U[3] };
 	}
 
 	template<typename PixelFormat>
 	void HOSVDCompressor<PixelFormat>::save(const std::string& _fileName)
 	{
 		std::ofstream file(_fileName, std::ios::binary);
+		file.write(HOSVD_TAG.data(), HOSVD_TAG.size());
 		file.write(reinterpret_cast<const char*>(&m_frameRate), sizeof(Video::FrameRate));
 		const int numBlocks = static_cast<int>(m_basis.size());
 		file.write(reinterpret_cast<const char*>(&numBlocks), sizeof(int));
@@ -66,12 +345,15 @@ namespace compression {
 		{
 			file.write(reinterpret_cast<const char*>(&m_frameRate), sizeof(Video::FrameRate));
 			m_core[i].save(file);
-			for (const auto& m : m_basis[i])
+			for (const auto& m : basis(i))
 			{
 				const Eigen::Index cols = m.cols();
 				const Eigen::Index rows = m.rows();
 				file.write(reinterpret_cast<const char*>(&cols), sizeof(Eigen::Index));
 				file.write(reinterpret_cast<const char*>(&rows), sizeof(Eigen::Index));
+				// align the data so that it can be mapped in place
+				constexpr char padding[memory::ALIGNMENT] = {};
+				file.write(padding, memory::alignmentPadding(static_cast<std::size_t>(file.tellp())));
 				file.write(reinterpret_cast<const char*>(m.data()), m.rows() * m.cols() * sizeof(float));
 			}
 		}
@@ -80,32 +362,202 @@ namespace compression {
 	template<typename PixelFormat>
 	void HOSVDCompressor<PixelFormat>::load(const std::string& _fileName)
 	{
-		std::ifstream file(_fileName, std::ios::binary);
+		// the tensors share ownership of the mapping
+		const auto file = std::make_shared<MappedFile>(_fileName);
+		char* ptr = file->data();
+		const char* const end = ptr + file->size();
+
+		auto read = [&](auto& _value)
+		{
+			if (ptr + sizeof(_value) > end)
+				throw std::string("Unexpected end of file " + _fileName + ".");
+			std::memcpy(&_value, ptr, sizeof(_value));
+			ptr += sizeof(_value);
+		};
 		
-		file.read(reinterpret_cast<char*>(&m_frameRate), sizeof(Video::FrameRate));
+		FormatTag tag;
+		read(tag);
+		if (tag != HOSVD_TAG)
+			throw std::string("The file " + _fileName + " was not written by the HOSVD compressor.");
+		read(m_frameRate);
 		int numBlocks = 0;
-		file.read(reinterpret_cast<char*>(&numBlocks), sizeof(int));
+		read(numBlocks);
 
+		m_core.clear();
+		m_basis.clear();
 		m_core.reserve(numBlocks);
 		m_basis.resize(numBlocks);
 		for (int j = 0; j < numBlocks; ++j)
 		{
-			m_core.emplace_back(file);
+			Video::FrameRate blockFrameRate;
+			read(blockFrameRate);
+			m_core.push_back(TensorType::mapSerialized(ptr, end, file));
 
-			for (size_t i = 0; i < m_basis[j].size(); ++i)
+			for (auto& m : m_basis[j])
 			{
-				auto& m = m_basis[j][i];
-
 				Eigen::Index cols = 0;
 				Eigen::Index rows = 0;
-				file.read(reinterpret_cast<char*>(&cols), sizeof(Eigen::Index));
-				file.read(reinterpret_cast<char*>(&rows), sizeof(Eigen::Index));
-				m.resize(rows, cols);
-				file.read(reinterpret_cast<char*>(m.data()), m.rows() * m.cols() * sizeof(float));
+				read(cols);
+				read(rows);
+				ptr += memory::alignmentPadding(reinterpret_cast<std::uintptr_t>(ptr));
+				const Eigen::Index available = ptr < end ? (end - ptr) / static_cast<Eigen::Index>(sizeof(float)) : 0;
+				if (rows < 0 || cols < 0 || (rows > 0 && cols > available / rows))
+					throw std::string("Unexpected end of file " + _fileName + ".");
+				m = BasisMatrix({ static_cast<int>(rows), static_cast<int>(cols) },
+					reinterpret_cast<float*>(ptr), file);
+				ptr += m.numElements() * sizeof(float);
 			}
 		}
 	}
 
+	// *************************************************************** //
+	template<typename PixelFormat>
+	TTCompressor<PixelFormat>::TTCompressor(const PixelFormat& _space)
+		: m_pixelFormat(_space),
+		m_numFramesPerBlock(24),
+		m_maxModeSize(16),
+		m_frameRate{ 1,24 },
+		m_truncation(new truncation::TruncationAdaptor(truncation::Zero()))
+	{}
+
+	template<typename PixelFormat>
+	void TTCompressor<PixelFormat>::encode(const Video& _video)
+	{
+		m_frameRate = _video.getFrameRate();
+
+		const size_t numFramesPerBlock = m_numFramesPerBlock > 0 ?
+			m_numFramesPerBlock : _video.getNumFrames();
+		const size_t numBlocks = _video.getNumFrames() / numFramesPerBlock
+			+ (_video.getNumFrames() % numFramesPerBlock != 0);
+
+		m_blockSizes.clear();
+		m_trains.clear();
+		m_blockSizes.reserve(numBlocks);
+		m_trains.reserve(numBlocks);
+
+		constexpr int numProgressSteps = 10;
+		int progress = 0;
+
+		for (size_t i = 0; i < numBlocks; ++i)
+		{
+			const auto tensor = _video.asTensor(i * numFramesPerBlock, numFramesPerBlock, m_pixelFormat);
+			const std::vector<int> modes = m_maxModeSize > 0
+				? details::quantizedModes(tensor.size(), m_maxModeSize)
+				: std::vector<int>(tensor.size().begin(), tensor.size().end());
+			m_blockSizes.push_back(tensor.size());
+			// the error is bounded by the energy discarded at all bonds
+			const int numBonds = std::max(1, static_cast<int>(modes.size()) - 1);
+			if (m_targetPSNR)
+				m_trains.push_back(ttSvd(tensor, modes, truncation::RelativeError::fromPSNR(*m_targetPSNR,
+					tensor.expr().squaredNorm(), tensor.numElements(), 1.0, numBonds)));
+			else if (m_relativeError)
+				m_trains.push_back(ttSvd(tensor, modes, truncation::RelativeError(*m_relativeError, numBonds)));
+			else
+				m_trains.push_back(ttSvd(tensor, modes, *m_truncation));
+
+			const int actualProgress = static_cast<int>(static_cast<float>(i + 1) / numBlocks * numProgressSteps);
+			for (; progress < actualProgress; ++progress)
+				std::cout << "#";
+		}
+		std::cout << "\n";
+	}
+
+	template<typename PixelFormat>
+	Video TTCompressor<PixelFormat>::decode() const
+	{
+		if (m_trains.empty())
+			throw std::string("Nothing to decode.");
+		Video video(m_trains[0].decode(m_blockSizes[0]), m_frameRate, m_pixelFormat);
+		for (size_t i = 1; i < m_trains.size(); ++i)
+		{
+			video.append(m_trains[i].decode(m_blockSizes[i]), m_pixelFormat);
+		}
+		return video;
+	}
+
+	template<typename PixelFormat>
+	void TTCompressor<PixelFormat>::decode(const std::string& _fileName) const
+	{
+		if (m_trains.empty())
+			throw std::string("Nothing to decode.");
+		decodeToFile(_fileName, m_trains.size(), m_blockSizes[0][1], m_blockSizes[0][2], m_frameRate, 1,
+			[this](size_t _block, Video& _video)
+			{
+				_video.append(m_trains[_block].decode(m_blockSizes[_block]), m_pixelFormat);
+			});
+	}
+
+	template<typename PixelFormat>
+	Video TTCompressor<PixelFormat>::decodeFrame(size_t _frame) const
+	{
+		size_t block = 0;
+		for (; block < m_trains.size() && _frame >= static_cast<size_t>(m_blockSizes[block][3]); ++block)
+			_frame -= m_blockSizes[block][3];
+		if (block == m_trains.size())
+			throw std::string("Frame index out of range.");
+
+		const TensorType tensor = m_trains[block].decode(m_blockSizes[block]);
+		return Video(tensor.slice(3, static_cast<int>(_frame), 1), m_frameRate, m_pixelFormat);
+	}
+
+	template<typename PixelFormat>
+	void TTCompressor<PixelFormat>::save(const std::string& _fileName)
+	{
+		std::ofstream file(_fileName, std::ios::binary);
+		file.write(TT_TAG.data(), TT_TAG.size());
+		file.write(reinterpret_cast<const char*>(&m_frameRate), sizeof(Video::FrameRate));
+		const int numBlocks = static_cast<int>(m_trains.size());
+		file.write(reinterpret_cast<const char*>(&numBlocks), sizeof(int));
+
+		for (size_t i = 0; i < m_trains.size(); ++i)
+		{
+			file.write(reinterpret_cast<const char*>(m_blockSizes[i].data()), m_blockSizes[i].size() * sizeof(int));
+			m_trains[i].save(file);
+		}
+	}
+
+	template<typename PixelFormat>
+	void TTCompressor<PixelFormat>::load(const std::string& _fileName)
+	{
+		const auto file = std::make_shared<MappedFile>(_fileName);
+		char* ptr = file->data();
+		const char* const end = ptr + file->size();
+
+		auto read = [&](auto& _value)
+		{
+			if (ptr + sizeof(_value) > end)
+				throw std::string("Unexpected end of file " + _fileName + ".");
+			std::memcpy(&_value, ptr, sizeof(_value));
+			ptr += sizeof(_value);
+		};
+
+		FormatTag tag;
+		read(tag);
+		if (tag != TT_TAG)
+			throw std::string("The file " + _fileName + " was not written by the tensor train compressor.");
+		read(m_frameRate);
+		int numBlocks = 0;
+		read(numBlocks);
+
+		m_blockSizes.resize(numBlocks);
+		m_trains.clear();
+		m_trains.reserve(numBlocks);
+		for (int j = 0; j < numBlocks; ++j)
+		{
+			read(m_blockSizes[j]);
+			int numCores = 0;
+			read(numCores);
+			std::vector<typename TrainType::Core> cores;
+			cores.reserve(numCores);
+			for (int k = 0; k < numCores; ++k)
+				cores.push_back(TrainType::Core::mapSerialized(ptr, end, file));
+			m_trains.emplace_back(std::move(cores));
+		}
+	}
+
+	template class TTCompressor<Video::YUV444>;
+	template class TTCompressor<Video::RGB>;
+
 	template class HOSVDCompressor<Video::YUV444>;
 	template class HOSVDCompressor<Video::RGB>;
 }
\ No newline at end of file
@@ -2,6 +2,38 @@
 
 #include "video/video.hpp"
 #include "truncation.hpp"
+#include "hosvd.hpp"
+#include "tt.hpp"
+#include <optional>
+
+namespace details {
+	// Rows [_begin, _begin + _count) of _U, averaged over groups of _factor rows.
+	// Rows of an incomplete last group are dropped.
+	inline Eigen::MatrixX<float> resampleRows(const Eigen::Ref<const Eigen::MatrixX<float>>& _U,
+		int _begin, int _count, int _factor)
+	{
+		Eigen::MatrixX<float> rows(_count / _factor, _U.cols());
+		for (Eigen::Index i = 0; i < rows.rows(); ++i)
+			rows.row(i) = _U.middleRows(_begin + i * _factor, _factor).colwise().mean();
+		return rows;
+	}
+
+	// Validates a decode region { x, y, width, height } of a _width x _height frame, where
+	// no region means the whole frame. The width and height are reduced such that the
+	// downscaled frames have an even size, which the video encoder requires.
+	inline std::array<int, 4> decodeRegion(const std::optional<std::array<int, 4>>& _region, int _downscale,
+		int _width, int _height)
+	{
+		std::array<int, 4> region = _region.value_or(std::array<int, 4>{ 0, 0, _width, _height });
+		if (_downscale < 1 || region[0] < 0 || region[1] < 0
+			|| region[2] < 2 * _downscale || region[3] < 2 * _downscale
+			|| region[0] + region[2] > _width || region[1] + region[3] > _height)
+			throw std::string("Invalid decode region.");
+		region[2] -= region[2] % (2 * _downscale);
+		region[3] -= region[3] % (2 * _downscale);
+		return region;
+	}
+}
 
 namespace compression {
 
@@ -15,25 +47,168 @@ namespace compression {
 
 		void encode(const Video& _video);
 		Video decode() const;
+		// Decodes into a video file; the next block is reconstructed while the frames of the
+		// previous one are encoded, so only a few blocks are in memory at once.
+		void decode(const std::string& _fileName) const;
+		// Decodes only the frame with index _frame of the whole video.
+		// The time mode of its block is contracted first, so only a single frame is expanded.
+		Video decodeFrame(size_t _frame) const;
 		void save(const std::string& _fileName);
+		// Maps the file into memory; the data is only read when decoding accesses it.
 		void load(const std::string& _fileName);
 		
 		template<typename Truncate>
 		void setTruncation(Truncate _truncation)
 		{
+			if constexpr (std::is_same_v<Truncate, truncation::Rank>)
+				m_rank = _truncation;
+			else
+				m_rank.reset();
 			m_truncation.reset(new truncation::TruncationAdaptor<Truncate>(_truncation));
 		}
 
+		// Two pass encoding: after all blocks are decomposed with the configured truncation,
+		// the ranks of all blocks are reduced together such that the saved file takes at most
+		// _maxBytes, see allocateRanks. 0 disables the budget.
+		void setMaxBytes(std::size_t _maxBytes) { m_maxBytes = _maxBytes; }
+		// Truncate each block with a truncation::RelativeError such that its peak signal-to-noise
+		// ratio is at least _psnr dB; takes precedence over setTruncation.
+		// Only applies to the full decomposition, see setIncremental.
+		void setTargetPSNR(double _psnr) { m_targetPSNR = _psnr; }
+
 		void setFramesPerBlock(int _numFrames) { m_numFramesPerBlock = _numFrames; }
+		// Store the video blocks as 16 bit floats during encoding.
+		// Computations are still done in float.
+		void setReducedPrecision(bool _enable) { m_reducedPrecision = _enable; }
+		// With a truncation::Rank, use hosvdRandomized with the given oversampling.
+		// A negative value selects the deterministic decomposition.
+		void setOversampling(int _oversampling) { m_oversampling = _oversampling; }
+		// Refine each block with up to _maxIterations HOOI iterations; 0 disables refinement.
+		// @param _minImprovement Relative error improvement below which the iteration stops.
+		void setRefinement(int _maxIterations, double _minImprovement = 1e-3)
+		{
+			m_refinementIterations = _maxIterations;
+			m_minImprovement = _minImprovement;
+		}
+		// Build the decomposition incrementally with IncrementalTucker, adding _numFrames
+		// frames at a time, so that a block is never stored as a whole; 0 disables this.
+		// Mode ordering, randomization and refinement only apply to the full decomposition.
+		// The bound of a truncation::RelativeError does not hold, see IncrementalTucker.
+		void setIncremental(size_t _numFrames) { m_incrementalFrames = _numFrames; }
+		// Start the decomposition of each block from the color and spatial bases of the previous
+		// block and refine them with _iterations subspace iterations, see hosvdWarmStarted.
+		// A negative value computes every block from scratch.
+		void setWarmStart(int _iterations) { m_warmStartIterations = _iterations; }
+		// Decode only the pixels [_x, _x + _width) x [_y, _y + _height) of every frame.
+		// Only the selected rows of the spatial bases are used, so the cost scales with the region.
+		// The size of the decoded frames is rounded down to even numbers, see details::decodeRegion.
+		void setRegion(int _x, int _y, int _width, int _height) { m_region = { _x, _y, _width, _height }; }
+		// Decode frames downscaled by an integer factor, where each pixel is the mean of
+		// _factor x _factor pixels of the (region of the) frame. The spatial bases are averaged
+		// before the products, so full size frames are never computed.
+		void setDownscale(int _factor) { m_downscale = _factor; }
+
+		// Basis matrices are stored as tensors so that they can be mapped from a file.
+		using BasisMatrix = Tensor<float, 2>;
+		using MatrixMap = Eigen::Map<const Eigen::MatrixX<float>, Eigen::Aligned64>;
 
 		const std::vector<TensorType>& singularValues() const { return m_core; }
-		const std::vector<std::array< Eigen::MatrixX<float>, 4>> basis() const { return m_basis; }
+		// Order in which the modes of each block were truncated during encode.
+		const std::vector<std::array<int, 4>>& modeOrders() const { return m_modeOrders; }
+		// Progress of the HOOI refinement for each block during encode.
+		const std::vector<std::vector<HOOIIteration>>& refinementStats() const { return m_refinementStats; }
+		// Outcome of the warm started bases during encode.
+		const WarmStartStats& warmStartStats() const { return m_warmStartStats; }
+		// Views of the basis matrices of a block.
+		std::array<MatrixMap, 4> basis(size_t _block) const
+		{
+			const auto& b = m_basis[_block];
+			return { b[0].mat(), b[1].mat(), b[2].mat(), b[3].mat() };
+		}
 	private:
+		// Second pass of setMaxBytes.
+		void truncateToBudget();
+		// Appends the frames of a block to _video.
+		void decodeBlock(size_t _block, Video& _video) const;
+		// Basis matrices of a block restricted to the region and downscaled.
+		std::array<Eigen::MatrixX<float>, 4> outputBasis(size_t _block) const;
+
 		PixelFormat m_pixelFormat;
 		size_t m_numFramesPerBlock;
+		bool m_reducedPrecision;
+		int m_oversampling;
+		std::optional<truncation::Rank> m_rank;
+		std::optional<double> m_targetPSNR;
+		std::size_t m_maxBytes;
+		int m_refinementIterations;
+		double m_minImprovement;
+		size_t m_incrementalFrames;
+		int m_warmStartIterations;
+		std::optional<std::array<int, 4>> m_region;
+		int m_downscale;
 		Video::FrameRate m_frameRate;
 		std::vector<TensorType> m_core;
-		std::vector<std::array< Eigen::MatrixX<float>, 4>> m_basis;
+		std::vector<std::array<BasisMatrix, 4>> m_basis;
+		std::vector<std::array<int, 4>> m_modeOrders;
+		std::vector<std::vector<HOOIIteration>> m_refinementStats;
+		WarmStartStats m_warmStartStats;
+
+		std::unique_ptr<truncation::AbstractTruncation> m_truncation;
+	};
+
+	// Compresses blocks of frames as tensor trains.
+	// Each block is reshaped into many small modes, for which the train is much smaller than
+	// a Tucker decomposition.
+	template<typename PixelFormat>
+	class TTCompressor
+	{
+	public:
+		using TensorType = typename PixelFormat::TensorType;
+		using TrainType = TensorTrain<float>;
+
+		explicit TTCompressor(const PixelFormat& _space);
+
+		void encode(const Video& _video);
+		Video decode() const;
+		// Decodes into a video file while the next block is reconstructed.
+		void decode(const std::string& _fileName) const;
+		// Decodes only the frame with index _frame of the whole video.
+		// The block containing the frame is decoded in full.
+		Video decodeFrame(size_t _frame) const;
+		void save(const std::string& _fileName);
+		// Maps the file into memory; the data is only read when decoding accesses it.
+		void load(const std::string& _fileName);
+
+		// The truncation is applied to the bonds of the train, not to the original modes.
+		// The error budget of a truncation::RelativeError is split over the bonds of each train.
+		template<typename Truncate>
+		void setTruncation(Truncate _truncation)
+		{
+			if constexpr (std::is_same_v<Truncate, truncation::RelativeError>)
+				m_relativeError = _truncation.eps;
+			else
+				m_relativeError.reset();
+			m_truncation.reset(new truncation::TruncationAdaptor<Truncate>(_truncation));
+		}
+
+		// Truncate each block such that its peak signal-to-noise ratio is at least _psnr dB;
+		// takes precedence over setTruncation.
+		void setTargetPSNR(double _psnr) { m_targetPSNR = _psnr; }
+
+		void setFramesPerBlock(int _numFrames) { m_numFramesPerBlock = _numFrames; }
+		// Modes of a block are split into factors of at most this size; 0 keeps the modes.
+		void setMaxModeSize(int _maxModeSize) { m_maxModeSize = _maxModeSize; }
+
+		const std::vector<TrainType>& trains() const { return m_trains; }
+	private:
+		PixelFormat m_pixelFormat;
+		size_t m_numFramesPerBlock;
+		int m_maxModeSize;
+		std::optional<double> m_targetPSNR;
+		std::optional<double> m_relativeError;
+		Video::FrameRate m_frameRate;
+		std::vector<typename TensorType::SizeVector> m_blockSizes;
+		std::vector<TrainType> m_trains;
 
 		std::unique_ptr<truncation::AbstractTruncation> m_truncation;
 	};
@@ -2,84 +2,645 @@
 
 #include "tensor.hpp"
 #include "truncation.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <omp.h>
 #include <variant>
 #include <limits>
+#include <optional>
+#include <random>
+#include <utility>
+
+// Algorithm used for the SVDs of the unfoldings.
+enum struct SVDMethod
+{
+	Auto, // Gram for wide matrices, otherwise BDC
+	BDC,  // divide and conquer SVD of the matrix
+	Gram  // eigendecomposition of X * X^T, much cheaper if cols >> rows
+};
+
+namespace details {
+	// Auto uses the Gram matrix if cols >= GRAM_RATIO * rows.
+	constexpr Eigen::Index GRAM_RATIO = 4;
+
+	// Left singular vectors and singular values of a matrix.
+	template<typename Scalar>
+	class LeftSVD
+	{
+	public:
+		template<typename Derived>
+		void compute(const Eigen::MatrixBase<Derived>& _m, SVDMethod _method)
+		{
+			if (_method == SVDMethod::Gram
+				|| (_method == SVDMethod::Auto && _m.cols() >= GRAM_RATIO * _m.rows()))
+				computeGram(_m);
+			else
+			{
+				m_svd.compute(_m, Eigen::ComputeThinU);
+				m_singularValues = m_svd.singularValues();
+				m_U = m_svd.matrixU();
+				m_rank = m_svd.rank();
+			}
+		}
+
+		// in decreasing order
+		const Eigen::VectorX<Scalar>& singularValues() const noexcept { return m_singularValues; }
+		const Eigen::MatrixX<Scalar>& matrixU() const noexcept { return m_U; }
+		Eigen::Index rank() const noexcept { return m_rank; }
+	private:
+		template<typename Derived>
+		void computeGram(const Eigen::MatrixBase<Derived>& _m)
+		{
+			using namespace Eigen;
+
+			// X * X^T as a sum of rank updates with column blocks, accumulated in double
+			const Index rows = _m.rows();
+			const Index blockCols = std::max(Index(256), Index(1 << 16) / std::max(rows, Index(1)));
+			const Index numBlocks = (_m.cols() + blockCols - 1) / blockCols;
+			MatrixXd gram = MatrixXd::Zero(rows, rows);
+#pragma omp parallel if(numBlocks > 1)
+			{
+				MatrixXd localGram = MatrixXd::Zero(rows, rows);
+#pragma omp for schedule(static)
+				for (Index b = 0; b < numBlocks; ++b)
+				{
+					const Index begin = b * blockCols;
+					const MatrixXd block = _m.middleCols(begin, std::min(blockCols, _m.cols() - begin))
+						.template cast<double>();
+					localGram.selfadjointView<Lower>().rankUpdate(block);
+				}
+#pragma omp critical
+				gram.template triangularView<Lower>() += localGram;
+			}
+
+			// eigenvalues are in increasing order
+			const SelfAdjointEigenSolver<MatrixXd> eigen(gram);
+			m_singularValues.resize(rows);
+			m_U.resize(rows, rows);
+			for (Index i = 0; i < rows; ++i)
+			{
+				const Index j = rows - 1 - i;
+				m_singularValues[i] = static_cast<Scalar>(std::sqrt(std::max(eigen.eigenvalues()[j], 0.0)));
+				m_U.col(i) = eigen.eigenvectors().col(j).template cast<Scalar>();
+			}
+
+			// same threshold as Eigen's SVDBase::rank()
+			const Scalar threshold = rows ? std::max(m_singularValues[0] * static_cast<Scalar>(rows)
+				* NumTraits<Scalar>::epsilon(), std::numeric_limits<Scalar>::min()) : Scalar(0);
+			m_rank = 0;
+			while (m_rank < rows && m_singularValues[m_rank] > threshold)
+				++m_rank;
+		}
+
+		Eigen::BDCSVD<Eigen::MatrixX<Scalar>> m_svd;
+		Eigen::VectorX<Scalar> m_singularValues;
+		Eigen::MatrixX<Scalar> m_U;
+		Eigen::Index m_rank = 0;
+	};
+
+	// Splits _budget threads among tasks which run concurrently, proportionally to their _cost
+	// by the largest remainder method. Every task gets at least one thread, so the shares sum
+	// to _budget, or to the number of tasks if there are more tasks than threads.
+	template<std::size_t N>
+	std::array<int, N> apportionThreads(const std::array<double, N>& _cost, int _budget)
+	{
+		std::array<int, N> threads;
+		threads.fill(1);
+		const int remaining = _budget - static_cast<int>(N);
+		double totalCost = 0.0;
+		for (double c : _cost)
+			totalCost += c;
+		if (remaining <= 0 || totalCost <= 0.0)
+			return threads;
+
+		std::array<double, N> remainder;
+		int assigned = 0;
+		for (std::size_t k = 0; k < N; ++k)
+		{
+			const double quota = remaining * _cost[k] / totalCost;
+			const int share = static_cast<int>(quota);
+			threads[k] += share;
+			remainder[k] = quota - share;
+			assigned += share;
+		}
+		std::array<std::size_t, N> order;
+		for (std::size_t k = 0; k < N; ++k)
+			order[k] = k;
+		std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return remainder[a] > remainder[b]; });
+		for (int i = 0; i < remaining - assigned; ++i)
+			++threads[order[i]];
+		return threads;
+	}
+}
 
 // Higher order singular value decomposition.
+// Tensors in a reduced precision storage type are decomposed in their ComputeType.
 // @param _tensor The tensor to decompose.
 // @param _tol Singular values smaller than this tolerance are truncated.
+// @param _method How the SVDs of the unfoldings are computed.
 // @return <array of U matrices, core tensor C> such that (U1, ..., Ud) * C == _tensor.
-template<typename Scalar, int Dims, typename Truncate = truncation::Zero>
-auto hosvd(const Tensor<Scalar, Dims>& _tensor, Truncate _truncate = truncation::Zero())
--> std::tuple < std::array<Eigen::MatrixX<Scalar>, Dims>, Tensor<Scalar, Dims>>
+template<typename Scalar, int Dims, typename Truncate = truncation::Zero,
+	typename ComputeScalar = details::ComputeType<Scalar>>
+auto hosvd(const Tensor<Scalar, Dims>& _tensor, Truncate _truncate = truncation::Zero(),
+	SVDMethod _method = SVDMethod::Auto)
+-> std::tuple < std::array<Eigen::MatrixX<ComputeScalar>, Dims>, Tensor<ComputeScalar, Dims>>
 {
 	using namespace Eigen;
 
-	std::array<MatrixX<Scalar>, Dims> basis;
+	std::array<MatrixX<ComputeScalar>, Dims> basis;
 
+	// The modes are independent and decomposed concurrently. Each mode gets a share of the
+	// thread budget proportional to the cost of its unfolding and SVD, which the nested
+	// parallel regions inside the task, e.g. the unfolding or the Gram matrix, then use.
+	// The shares sum to the budget; with more modes than threads, each mode gets one.
+	// Up to one unfolding per mode is held in memory at once.
+	const int budget = omp_get_max_threads();
+	const double numElements = static_cast<double>(_tensor.numElements());
+	std::array<double, Dims> cost;
+	std::array<int, Dims> modes;
 	for (int k = 0; k < Dims; ++k)
 	{
-		const MatrixX<Scalar> m = _tensor.flatten(k);
-		BDCSVD< MatrixX<Scalar>> svd(m, ComputeThinU);
+		const double rows = _tensor.size()[k];
+		const double cols = numElements / rows;
+		cost[k] = numElements + std::min(rows, cols) * std::min(rows, cols) * std::max(rows, cols);
+		modes[k] = k;
+	}
+	const std::array<int, Dims> threads = details::apportionThreads(cost, budget);
+	// start the expensive modes first
+	std::sort(modes.begin(), modes.end(), [&](int a, int b) { return cost[a] > cost[b]; });
+
+	const int maxActiveLevels = omp_get_max_active_levels();
+	omp_set_max_active_levels(std::max(maxActiveLevels, 2));
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(Dims, budget))
+	for (int i = 0; i < Dims; ++i)
+	{
+		const int k = modes[i];
+		omp_set_num_threads(threads[k]);
+
+		const MatrixX<ComputeScalar> m = _tensor.flatten(k);
+		details::LeftSVD<ComputeScalar> svd;
+		svd.compute(m, _method);
 
 		const Index newRank = std::min(_truncate(svd.singularValues(), k), svd.rank());
 		basis[k] = svd.matrixU().leftCols(newRank);
 	}
+	omp_set_max_active_levels(maxActiveLevels);
 
 	return { basis, multilinearProduct(basis, _tensor, true) };
 }
 
 namespace details {
-	template<int K, typename Scalar, int Dims, std::size_t DimsA, typename Truncate>
-	void hosvdInterlacedImpl(Tensor<Scalar, Dims>& _tensor,
-		const Truncate& _truncate,
+	// @param _tensor Input of this step, either the original tensor or _core.
+	// @param _core Receives the partially projected tensor.
+	// @param _computeBasis Returns the truncated basis as _computeBasis(flattening, k).
+	// @param _order Mode processed in each step.
+	template<int Step, typename SrcScalar, typename Scalar, int Dims, std::size_t DimsA, typename ComputeBasis>
+	void hosvdInterlacedImpl(const TensorView<const SrcScalar, Dims>& _tensor,
+		Tensor<Scalar, Dims>& _core,
 		std::array<Eigen::MatrixX<Scalar>, DimsA>& _basis,
-		Eigen::BDCSVD< Eigen::MatrixX<Scalar>>& _svd)
+		ComputeBasis& _computeBasis,
+		const std::array<int, DimsA>& _order,
+		Tensor<Scalar, Dims>& _buffer)
 	{
 		using namespace Eigen;
 
-		// extra scope to enforce release of resources before the recursive call
+		const int k = _order[Step];
+		// extra scope to enforce release of the flattening before the product
 		{
-			const MatrixX<Scalar> m = _tensor.template flatten<K>();
-			_svd.compute(m, ComputeThinU);
+			const MatrixX<Scalar> m = _tensor.flatten(k);
+			_basis[k] = _computeBasis(m, k);
+		}
 
-			const Index newRank = std::min(_truncate(_svd.singularValues(), K), _svd.rank());
-			_basis[K] = _svd.matrixU().leftCols(newRank);
-			const MatrixX<Scalar> flatNext = _basis[K].transpose() * m;
+		// project onto the truncated basis; shrinks the tensor if truncation took place
+		modeProduct(_basis[k], _tensor, _buffer, k, true);
+		std::swap(_core, _buffer);
 
-			// shrink tensor if truncation took place
-			auto size = _tensor.size();
-			if (flatNext.rows() < size[K])
-			{
-				size[K] = static_cast<int>(flatNext.rows());
-				_tensor.resize(size);
-			}
+		if constexpr (Step < Dims - 1)
+			hosvdInterlacedImpl<Step + 1>(std::as_const(_core).view(), _core, _basis, _computeBasis, _order, _buffer);
+	}
 
-			_tensor.template set<K>(flatNext);
+	// Estimated number of operations of a sequentially truncated HOSVD.
+	// Counts the passes over the tensor for flattening and projection, the SVD
+	// of each unfolding and the projection product.
+	template<std::size_t Dims>
+	double hosvdCost(const std::array<int, Dims>& _size,
+		const std::array<int, Dims>& _ranks,
+		const std::array<int, Dims>& _order)
+	{
+		double numElements = 1.0;
+		for (int s : _size)
+			numElements *= s;
+
+		double cost = 0.0;
+		for (int k : _order)
+		{
+			const double rows = _size[k];
+			const double cols = numElements / rows;
+			const double rank = std::min(_ranks[k], _size[k]);
+			cost += 2.0 * numElements
+				+ std::min(rows, cols) * std::min(rows, cols) * std::max(rows, cols)
+				+ rank * numElements;
+			numElements = cols * rank;
+		}
+		return cost;
+	}
+
+	// Ranks that a truncation will produce if they are known in advance, otherwise the full size.
+	template<typename Truncate, std::size_t Dims>
+	std::array<int, Dims> expectedRanks(const Truncate& _truncate, const std::array<int, Dims>& _size)
+	{
+		std::array<int, Dims> ranks = _size;
+		if constexpr (std::is_same_v<Truncate, truncation::Rank>)
+		{
+			for (std::size_t k = 0; k < Dims; ++k)
+				ranks[k] = static_cast<int>(std::min<Eigen::Index>(_size[k],
+					_truncate(Eigen::VectorX<float>(), static_cast<int>(k))));
+		}
+		return ranks;
+	}
+
+	// Approximates the leading _rank left singular vectors of _m with a randomized range finder.
+	// @param _svd Used for the small SVD of the projected matrix.
+	template<typename Scalar, typename RNG>
+	Eigen::MatrixX<Scalar> randomizedBasis(const Eigen::MatrixX<Scalar>& _m,
+		Eigen::Index _rank,
+		int _oversampling,
+		int _powerIterations,
+		LeftSVD<Scalar>& _svd,
+		RNG& _rng)
+	{
+		using namespace Eigen;
+
+		const Index rows = _m.rows();
+		const Index sketchSize = std::min(rows, _rank + _oversampling);
+		// nothing to save for small modes
+		if (sketchSize == rows)
+		{
+			_svd.compute(_m, SVDMethod::Auto);
+			return _svd.matrixU().leftCols(std::min(_rank, _svd.rank()));
+		}
+
+		// orthonormal basis of the range of _m * omega for a Gaussian omega
+		std::normal_distribution<Scalar> normal;
+		MatrixX<Scalar> omega(_m.cols(), sketchSize);
+		for (Index i = 0; i < omega.size(); ++i)
+			omega.data()[i] = normal(_rng);
+
+		HouseholderQR<MatrixX<Scalar>> qr(_m * omega);
+		MatrixX<Scalar> Q = qr.householderQ() * MatrixX<Scalar>::Identity(rows, sketchSize);
+		// power iterations sharpen the spectrum; the basis is reorthonormalized after each
+		for (int i = 0; i < _powerIterations; ++i)
+		{
+			omega.noalias() = _m.transpose() * Q;
+			qr.compute(_m * omega);
+			Q = qr.householderQ() * MatrixX<Scalar>::Identity(rows, sketchSize);
 		}
 
-		if constexpr (K < Dims - 1)
-			hosvdInterlacedImpl<K + 1>(_tensor, _truncate, _basis, _svd);
+		// small SVD of the projection onto the sketched subspace
+		{
+			const MatrixX<Scalar> projected = Q.transpose() * _m;
+			_svd.compute(projected, SVDMethod::Auto);
+		}
+		return Q * _svd.matrixU().leftCols(std::min(_rank, _svd.rank()));
 	}
+
+	// Number of random directions added to an initial basis to pick up new dominant directions.
+	constexpr Eigen::Index WARM_START_OVERSAMPLING = 8;
+
+	// Refines _initial, an approximate basis of the dominant left singular subspace of _m,
+	// with subspace iterations and truncates the result with _truncate.
+	// @return The truncated basis or nothing if the residual check fails, that is if the
+	//	truncation would keep the whole subspace or the part of _m outside of it, or if that
+	//	part has a larger norm than the smallest kept singular value.
+	template<typename Scalar, typename Derived, typename Truncate>
+	std::optional<Eigen::MatrixX<Scalar>> warmStartedBasis(const Eigen::MatrixX<Scalar>& _m,
+		const Eigen::MatrixBase<Derived>& _initial,
+		const Truncate& _truncate,
+		int _k,
+		int _iterations,
+		LeftSVD<Scalar>& _svd)
+	{
+		using namespace Eigen;
+
+		const Index rows = _m.rows();
+		const Index sketchSize = std::min(rows, _initial.cols() + WARM_START_OVERSAMPLING);
+		// fixed seed for reproducible results
+		std::default_random_engine rng(0x2a4c91);
+		std::normal_distribution<Scalar> normal;
+		MatrixX<Scalar> Q(rows, sketchSize);
+		Q.leftCols(_initial.cols()) = _initial.template cast<Scalar>();
+		for (Index i = _initial.cols() * rows; i < Q.size(); ++i)
+			Q.data()[i] = normal(rng);
+
+		HouseholderQR<MatrixX<Scalar>> qr(Q);
+		Q = qr.householderQ() * MatrixX<Scalar>::Identity(rows, sketchSize);
+		MatrixX<Scalar> Z;
+		for (int i = 0; i < _iterations; ++i)
+		{
+			Z.noalias() = _m.transpose() * Q;
+			qr.compute(_m * Z);
+			Q = qr.householderQ() * MatrixX<Scalar>::Identity(rows, sketchSize);
+		}
+
+		{
+			const MatrixX<Scalar> projected = Q.transpose() * _m;
+			_svd.compute(projected, SVDMethod::Auto);
+		}
+		// The part of _m outside of the subspace is passed as a trailing singular value, so that
+		// truncations which budget the discarded energy, e.g. RelativeError, account for it.
+		const Index numSingularValues = _svd.singularValues().size();
+		VectorX<Scalar> singularValues(numSingularValues + 1);
+		singularValues.head(numSingularValues) = _svd.singularValues();
+		singularValues[numSingularValues] = static_cast<Scalar>(std::sqrt(std::max(0.0,
+			static_cast<double>(_m.squaredNorm()) - _svd.singularValues().template cast<double>().squaredNorm())));
+		const Index wantedRank = _truncate(singularValues, _k);
+		const Index newRank = std::min(wantedRank, _svd.rank());
+		if (wantedRank > numSingularValues || newRank >= sketchSize)
+			return std::nullopt;
+
+		// power iterations for the spectral norm of the residual (I - Q * Q^T) * _m
+		VectorX<Scalar> v(_m.cols());
+		for (Index i = 0; i < v.size(); ++i)
+			v[i] = normal(rng);
+		v.normalize();
+		Scalar residualNorm2 = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			VectorX<Scalar> u = _m * v;
+			u -= Q * (Q.transpose() * u);
+			v.noalias() = _m.transpose() * u;
+			residualNorm2 = v.norm();
+			if (residualNorm2 == Scalar(0))
+				break;
+			v /= residualNorm2;
+		}
+		if (newRank > 0 && residualNorm2 > _svd.singularValues()[newRank - 1] * _svd.singularValues()[newRank - 1])
+			return std::nullopt;
+
+		return MatrixX<Scalar>(Q * _svd.matrixU().leftCols(newRank));
+	}
+}
+
+// Order of the modes with the lowest estimated cost for the sequentially truncated HOSVD.
+// If truncation does not shrink the tensor, all orders are equivalent and the natural
+// order is returned.
+// @param _ranks Expected ranks after truncation.
+template<std::size_t Dims>
+std::array<int, Dims> optimalModeOrder(const std::array<int, Dims>& _size,
+	const std::array<int, Dims>& _ranks)
+{
+	std::array<int, Dims> order;
+	for (std::size_t k = 0; k < Dims; ++k)
+		order[k] = static_cast<int>(k);
+
+	std::array<int, Dims> best = order;
+	double bestCost = details::hosvdCost(_size, _ranks, order);
+	while (std::next_permutation(order.begin(), order.end()))
+	{
+		const double cost = details::hosvdCost(_size, _ranks, order);
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			best = order;
+		}
+	}
+	return best;
+}
+
+template<std::size_t Dims, typename Truncate>
+std::array<int, Dims> optimalModeOrder(const std::array<int, Dims>& _size, const Truncate& _truncate)
+{
+	return optimalModeOrder(_size, details::expectedRanks(_truncate, _size));
 }
 
 // Interlaced higher order singular value decomposition.
 // See hosvd for a description of the parameters.
 // This method is significantly faster than hosvd if the numeric rank of the input is
 // low or truncation due to a high tolerance takes place.
-template<typename Scalar, int Dims, typename Truncate = truncation::Zero>
+// @param _order Permutation of the modes in which they are truncated.
+template<typename Scalar, int Dims, typename Truncate,
+	typename ComputeScalar = details::ComputeType<Scalar>>
 auto hosvdInterlaced(const Tensor<Scalar, Dims>& _tensor, 
-	const Truncate& _truncate = truncation::Zero())
--> std::tuple < std::array<Eigen::MatrixX<Scalar>, Dims>, Tensor<Scalar, Dims>>
+	const Truncate& _truncate,
+	const typename Tensor<Scalar, Dims>::SizeVector& _order,
+	SVDMethod _method = SVDMethod::Auto)
+-> std::tuple < std::array<Eigen::MatrixX<ComputeScalar>, Dims>, Tensor<ComputeScalar, Dims>>
+{
+	using namespace Eigen;
+
+	std::array<MatrixX<ComputeScalar>, Dims> basis;
+
+	// the first step reads directly from _tensor, so no copy of the input is required
+	Tensor<ComputeScalar, Dims> core;
+	details::LeftSVD<ComputeScalar> svd;
+	auto computeBasis = [&](const MatrixX<ComputeScalar>& _m, int _k) -> MatrixX<ComputeScalar>
+	{
+		svd.compute(_m, _method);
+		const Index newRank = std::min(_truncate(svd.singularValues(), _k), svd.rank());
+		return svd.matrixU().leftCols(newRank);
+	};
+	Tensor<ComputeScalar, Dims> buffer;
+	details::hosvdInterlacedImpl<0>(_tensor.view(), core, basis, computeBasis, _order, buffer);
+
+	return { std::move(basis), std::move(core) };
+}
+
+// Processes the modes in the order given by optimalModeOrder.
+template<typename Scalar, int Dims, typename Truncate = truncation::Zero,
+	typename ComputeScalar = details::ComputeType<Scalar>>
+auto hosvdInterlaced(const Tensor<Scalar, Dims>& _tensor,
+	const Truncate& _truncate = truncation::Zero(),
+	SVDMethod _method = SVDMethod::Auto)
+{
+	return hosvdInterlaced<Scalar, Dims, Truncate, ComputeScalar>(_tensor, _truncate,
+		optimalModeOrder(_tensor.size(), _truncate), _method);
+}
+
+// Randomized interlaced HOSVD for a prescribed multilinear rank.
+// The basis of each unfolding is taken from a Gaussian sketch with _rank + _oversampling
+// columns, so only a small SVD is computed and the cost is O(N * rank) per mode.
+// @param _powerIterations Number of subspace iterations to improve the accuracy
+//	for slowly decaying singular values.
+// @param _order Permutation of the modes in which they are truncated; by default optimalModeOrder.
+template<typename Scalar, int Dims, typename ComputeScalar = details::ComputeType<Scalar>>
+auto hosvdRandomized(const Tensor<Scalar, Dims>& _tensor,
+	const truncation::Rank& _rank,
+	int _oversampling = 10,
+	int _powerIterations = 1,
+	std::optional<typename Tensor<Scalar, Dims>::SizeVector> _order = std::nullopt)
+-> std::tuple < std::array<Eigen::MatrixX<ComputeScalar>, Dims>, Tensor<ComputeScalar, Dims>>
+{
+	using namespace Eigen;
+
+	std::array<MatrixX<ComputeScalar>, Dims> basis;
+
+	Tensor<ComputeScalar, Dims> core;
+	details::LeftSVD<ComputeScalar> svd;
+	// fixed seed for reproducible results
+	std::default_random_engine rng(0x2a4c91);
+	auto computeBasis = [&](const MatrixX<ComputeScalar>& _m, int _k)
+	{
+		const Index rank = _rank(VectorX<ComputeScalar>(), _k);
+		return details::randomizedBasis(_m, rank, _oversampling, _powerIterations, svd, rng);
+	};
+	Tensor<ComputeScalar, Dims> buffer;
+	details::hosvdInterlacedImpl<0>(_tensor.view(), core, basis, computeBasis,
+		_order ? *_order : optimalModeOrder(_tensor.size(), _rank), buffer);
+
+	return { std::move(basis), std::move(core) };
+}
+
+// Outcome of the warm started modes of hosvdWarmStarted.
+struct WarmStartStats
+{
+	int numRefined = 0;   // bases computed from the initial basis
+	int numFallbacks = 0; // bases which failed the residual check and required a full SVD
+};
+
+// Interlaced HOSVD which starts from the bases of a similar tensor, e.g. the previous block
+// of a video. The basis of each mode is refined with a few subspace iterations, which only
+// requires products with the unfolding instead of its SVD.
+// See hosvdInterlaced for the other parameters.
+// @param _initial Initial basis of each mode. Modes for which it is empty, has the wrong
+//	number of rows or would not be smaller than a full basis use a full SVD.
+// @param _iterations Number of subspace iterations per mode.
+// @param _stats If given, accumulates the outcome of the warm started modes.
+template<typename Scalar, int Dims, typename Truncate, typename MatrixT, std::size_t DimsA,
+	typename ComputeScalar = details::ComputeType<Scalar>>
+auto hosvdWarmStarted(const Tensor<Scalar, Dims>& _tensor,
+	const Truncate& _truncate,
+	const std::array<MatrixT, DimsA>& _initial,
+	const typename Tensor<Scalar, Dims>::SizeVector& _order,
+	int _iterations = 1,
+	WarmStartStats* _stats = nullptr,
+	SVDMethod _method = SVDMethod::Auto)
+-> std::tuple < std::array<Eigen::MatrixX<ComputeScalar>, Dims>, Tensor<ComputeScalar, Dims>>
 {
 	using namespace Eigen;
 
-	std::array<MatrixX<Scalar>, Dims> basis;
+	std::array<MatrixX<ComputeScalar>, Dims> basis;
 
-	Tensor<Scalar, Dims> core = _tensor;
-	BDCSVD< MatrixX<Scalar>> svd; //JacobiSVD, BDCSVD
-	details::hosvdInterlacedImpl<0>(core, _truncate, basis, svd);
+	Tensor<ComputeScalar, Dims> core;
+	details::LeftSVD<ComputeScalar> svd;
+	auto computeBasis = [&](const MatrixX<ComputeScalar>& _m, int _k) -> MatrixX<ComputeScalar>
+	{
+		const auto& initial = _initial[_k];
+		if (initial.cols() > 0 && initial.rows() == _m.rows()
+			&& initial.cols() + details::WARM_START_OVERSAMPLING < _m.rows())
+		{
+			if (auto refined = details::warmStartedBasis(_m, initial, _truncate, _k, _iterations, svd))
+			{
+				if (_stats) ++_stats->numRefined;
+				return std::move(*refined);
+			}
+			if (_stats) ++_stats->numFallbacks;
+		}
+		svd.compute(_m, _method);
+		const Index newRank = std::min(_truncate(svd.singularValues(), _k), svd.rank());
+		return svd.matrixU().leftCols(newRank);
+	};
+	Tensor<ComputeScalar, Dims> buffer;
+	details::hosvdInterlacedImpl<0>(_tensor.view(), core, basis, computeBasis, _order, buffer);
 
 	return { std::move(basis), std::move(core) };
-}
\ No newline at end of file
+}
+
+namespace details {
+	// Multiplies _tensor with the transposed basis matrices of all modes except _skip.
+	// @param _order Order in which the modes are multiplied.
+	template<typename SrcScalar, typename Scalar, int Dims, std::size_t DimsA>
+	void projectExcept(const TensorView<const SrcScalar, Dims>& _tensor,
+		const std::array<Eigen::MatrixX<Scalar>, DimsA>& _basis,
+		int _skip,
+		const std::array<int, DimsA>& _order,
+		Tensor<Scalar, Dims>& _result,
+		Tensor<Scalar, Dims>& _buffer)
+	{
+		static_assert(Dims > 1);
+		bool first = true;
+		for (int k : _order)
+		{
+			if (k == _skip) continue;
+			if (first)
+			{
+				modeProduct(_basis[k], _tensor, _result, k, true);
+				first = false;
+			}
+			else
+			{
+				modeProduct(_basis[k], std::as_const(_result).view(), _buffer, k, true);
+				std::swap(_result, _buffer);
+			}
+		}
+	}
+}
+
+// Progress of one HOOI iteration.
+struct HOOIIteration
+{
+	double relativeError; // ||T - (U1, ..., Ud) * C|| / ||T||
+	double seconds;
+};
+
+// Higher-order orthogonal iteration.
+// Refines a Tucker decomposition, e.g. from hosvdInterlaced, while keeping its ranks.
+// Each iteration recomputes the basis of every mode from the tensor projected onto the
+// current basis of all other modes.
+// @param _basis, _core The decomposition to improve; updated in place.
+// @param _maxIterations Upper bound on the number of iterations.
+// @param _minImprovement Stop once an iteration reduces the error by less than this fraction.
+// @return Error and duration of every iteration.
+template<typename Scalar, int Dims, typename ComputeScalar, std::size_t DimsA>
+std::vector<HOOIIteration> hooi(const Tensor<Scalar, Dims>& _tensor,
+	std::array<Eigen::MatrixX<ComputeScalar>, DimsA>& _basis,
+	Tensor<ComputeScalar, Dims>& _core,
+	int _maxIterations = 10,
+	double _minImprovement = 1e-3)
+{
+	using namespace Eigen;
+	using Clock = std::chrono::high_resolution_clock;
+
+	// with orthonormal bases ||T - (U1, ..., Ud) * C||^2 = ||T||^2 - ||C||^2
+	const double tensorNorm2 = _tensor.expr().squaredNorm();
+	auto relativeError = [&]()
+	{
+		return tensorNorm2 > 0.0
+			? std::sqrt(std::max(tensorNorm2 - _core.expr().squaredNorm(), 0.0) / tensorNorm2)
+			: 0.0;
+	};
+
+	std::array<int, Dims> ranks;
+	for (int k = 0; k < Dims; ++k)
+		ranks[k] = static_cast<int>(_basis[k].cols());
+	const std::array<int, Dims> order = optimalModeOrder(_tensor.size(), ranks);
+
+	std::vector<HOOIIteration> iterations;
+	details::LeftSVD<ComputeScalar> svd;
+	Tensor<ComputeScalar, Dims> partial;
+	Tensor<ComputeScalar, Dims> buffer;
+	double error = relativeError();
+	for (int i = 0; i < _maxIterations; ++i)
+	{
+		const auto start = Clock::now();
+		for (int k : order)
+		{
+			details::projectExcept(_tensor.view(), _basis, k, order, partial, buffer);
+			{
+				const MatrixX<ComputeScalar> m = partial.flatten(k);
+				svd.compute(m, SVDMethod::Auto);
+			}
+			_basis[k] = svd.matrixU().leftCols(std::min(ranks[k], static_cast<int>(svd.rank())));
+		}
+		// the last partial product only lacks the last mode
+		modeProduct(_basis[order.back()], std::as_const(partial).view(), _core, order.back(), true);
+
+		const double previousError = error;
+		error = relativeError();
+		iterations.push_back({ error, std::chrono::duration<double>(Clock::now() - start).count() });
+		if (previousError - error < _minImprovement * previousError)
+			break;
+	}
+
+	return iterations;
+}
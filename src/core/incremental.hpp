@@ -0,0 +1,123 @@
+#pragma once
+
+#include "hosvd.hpp"
+
+// Tucker decomposition which is built slice by slice along the last mode, e.g. frame by frame.
+// The bases of the other modes are maintained with incremental SVDs of the unfoldings:
+// the left singular vectors of [X, A] are those of [U * S, A] if X = U * S * V^T.
+// The last mode is updated the same way from the right: the core and the basis of the last
+// mode are the truncated SVD of the projected slices, so the memory is proportional to the
+// core plus the number of slices times the last rank instead of the full size of the tensor.
+// @param Truncate Applied to the singular values after every update; has to outlive this object.
+//	The discarded energy accumulates over the updates, so error bounds like
+//	truncation::RelativeError do not hold for the result.
+template<typename Scalar, int Dims, typename Truncate>
+class IncrementalTucker
+{
+public:
+	explicit IncrementalTucker(const Truncate& _truncate, SVDMethod _method = SVDMethod::Auto)
+		: m_truncate(_truncate), m_method(_method)
+	{}
+
+	// Adds one or more slices along the last mode.
+	template<typename SrcScalar>
+	void add(const TensorView<const SrcScalar, Dims>& _slices)
+	{
+		using namespace Eigen;
+
+		std::array<MatrixX<Scalar>, Dims> rotation;
+		for (int k = 0; k < Dims - 1; ++k)
+		{
+			// extra scope to release the unfoldings before the projection
+			{
+				const MatrixX<Scalar> newColumns = _slices.flatten(k);
+				if (empty())
+					m_svd.compute(newColumns, m_method);
+				else
+				{
+					MatrixX<Scalar> m(newColumns.rows(), m_basis[k].cols() + newColumns.cols());
+					m << m_basis[k] * m_singularValues[k].asDiagonal(), newColumns;
+					m_svd.compute(m, m_method);
+				}
+			}
+
+			const Index newRank = std::min(m_truncate(m_svd.singularValues(), k), m_svd.rank());
+			MatrixX<Scalar> basis = m_svd.matrixU().leftCols(newRank);
+			if (!empty())
+				rotation[k] = basis.transpose() * m_basis[k];
+			m_basis[k] = std::move(basis);
+			m_singularValues[k] = m_svd.singularValues().head(newRank);
+		}
+
+		// express the previous core in the new bases
+		for (int k = 0; k < Dims - 1 && !empty(); ++k)
+		{
+			modeProduct(rotation[k], std::as_const(m_core).view(), m_buffer, k);
+			std::swap(m_core, m_buffer);
+		}
+
+		// the last mode is not projected
+		modeProduct(m_basis[0], _slices, m_buffer, 0, true);
+		for (int k = 1; k < Dims - 1; ++k)
+		{
+			modeProduct(m_basis[k], std::as_const(m_buffer).view(), m_slices, k, true);
+			std::swap(m_buffer, m_slices);
+		}
+
+		// The projected slices are [C_(LAST)^T * V^T, B] = [C_(LAST)^T, B] * diag(V, I)^T and the
+		// right singular vectors W of [C_(LAST)^T, B] give the new basis diag(V, I) * W.
+		constexpr int LAST = Dims - 1;
+		if (empty())
+			std::swap(m_core, m_buffer);
+		else
+			m_core.append(m_buffer);
+		{
+			const MatrixX<Scalar> m = m_core.flatten(LAST);
+			m_svd.compute(m, m_method);
+		}
+		const Index newRank = std::min(m_truncate(m_svd.singularValues(), LAST), m_svd.rank());
+		const MatrixX<Scalar> W = m_svd.matrixU().leftCols(newRank);
+		modeProduct(W, std::as_const(m_core).view(), m_buffer, LAST, true);
+		std::swap(m_core, m_buffer);
+
+		const int numNewSlices = _slices.size()[LAST];
+		MatrixX<Scalar> temporal(m_numSlices + numNewSlices, newRank);
+		temporal.topRows(m_numSlices) = m_temporal * W.topRows(m_temporal.cols());
+		temporal.bottomRows(numNewSlices) = W.bottomRows(numNewSlices);
+		m_temporal = std::move(temporal);
+		m_numSlices += numNewSlices;
+	}
+
+	template<typename SrcScalar, typename Allocator>
+	void add(const Tensor<SrcScalar, Dims, Allocator>& _slices)
+	{
+		add(_slices.view());
+	}
+
+	// @return <array of U matrices, core tensor C> like hosvdInterlaced.
+	auto finalize() const
+		-> std::tuple<std::array<Eigen::MatrixX<Scalar>, Dims>, Tensor<Scalar, Dims>>
+	{
+		std::array<Eigen::MatrixX<Scalar>, Dims> basis;
+		for (int k = 0; k < Dims - 1; ++k)
+			basis[k] = m_basis[k];
+		basis[Dims - 1] = m_temporal;
+		return { std::move(basis), m_core };
+	}
+
+	bool empty() const noexcept { return m_numSlices == 0; }
+	int numSlices() const noexcept { return m_numSlices; }
+	// current rank of mode _k
+	Eigen::Index rank(int _k) const noexcept { return _k < Dims - 1 ? m_basis[_k].cols() : m_temporal.cols(); }
+private:
+	const Truncate& m_truncate;
+	SVDMethod m_method;
+	int m_numSlices = 0;
+	std::array<Eigen::MatrixX<Scalar>, Dims - 1> m_basis;
+	std::array<Eigen::VectorX<Scalar>, Dims - 1> m_singularValues;
+	Eigen::MatrixX<Scalar> m_temporal;
+	Tensor<Scalar, Dims> m_core;
+	Tensor<Scalar, Dims> m_buffer;
+	Tensor<Scalar, Dims> m_slices;
+	details::LeftSVD<Scalar> m_svd;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Eigen/Eigen>
+#include <array>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Spectra of a Tucker decomposition of one block, input to allocateRanks.
+template<std::size_t Dims>
+struct BlockSpectrum
+{
+	// size of the decomposed block
+	std::array<int, Dims> size;
+	// squared singular values of each mode in decreasing order; the length is the current rank
+	std::array<Eigen::VectorXd, Dims> energy;
+};
+
+namespace details {
+	// Number of elements of the bases and the core for the given ranks.
+	template<std::size_t Dims>
+	std::size_t tuckerElements(const std::array<int, Dims>& _size, const std::array<int, Dims>& _ranks)
+	{
+		std::size_t core = 1;
+		std::size_t basis = 0;
+		for (std::size_t k = 0; k < Dims; ++k)
+		{
+			core *= _ranks[k];
+			basis += static_cast<std::size_t>(_size[k]) * _ranks[k];
+		}
+		return core + basis;
+	}
+}
+
+// Chooses the ranks of all blocks such that their decompositions take at most _maxBytes while
+// minimizing the summed discarded energy, which bounds the squared error of the truncation.
+// Starting from the full ranks, the rank which loses the least energy per saved byte is
+// reduced until the budget is met. Every rank stays at least 1.
+// @param _bytesPerBlock Storage of a block which does not depend on the ranks, e.g. headers.
+// @return The ranks of each block.
+template<std::size_t Dims>
+std::vector<std::array<int, Dims>> allocateRanks(const std::vector<BlockSpectrum<Dims>>& _blocks,
+	std::size_t _maxBytes,
+	std::size_t _bytesPerBlock,
+	std::size_t _bytesPerElement = sizeof(float))
+{
+	std::vector<std::array<int, Dims>> ranks(_blocks.size());
+	std::size_t totalBytes = 0;
+	for (std::size_t b = 0; b < _blocks.size(); ++b)
+	{
+		for (std::size_t k = 0; k < Dims; ++k)
+			ranks[b][k] = static_cast<int>(_blocks[b].energy[k].size());
+		totalBytes += _bytesPerBlock + details::tuckerElements(_blocks[b].size, ranks[b]) * _bytesPerElement;
+	}
+
+	struct Candidate
+	{
+		double costPerByte;
+		std::size_t block;
+		int mode;
+		std::size_t savedBytes;
+		bool operator>(const Candidate& _oth) const { return costPerByte > _oth.costPerByte; }
+	};
+	// the cheapest reduction of a block changes only when the block itself is reduced
+	auto bestCandidate = [&](std::size_t _b, Candidate& _candidate)
+	{
+		const std::size_t bytes = details::tuckerElements(_blocks[_b].size, ranks[_b]) * _bytesPerElement;
+		bool found = false;
+		for (std::size_t k = 0; k < Dims; ++k)
+		{
+			if (ranks[_b][k] <= 1) continue;
+			std::array<int, Dims> reduced = ranks[_b];
+			--reduced[k];
+			const std::size_t saved = bytes - details::tuckerElements(_blocks[_b].size, reduced) * _bytesPerElement;
+			const double cost = _blocks[_b].energy[k][ranks[_b][k] - 1] / static_cast<double>(saved);
+			if (!found || cost < _candidate.costPerByte)
+			{
+				_candidate = { cost, _b, static_cast<int>(k), saved };
+				found = true;
+			}
+		}
+		return found;
+	};
+
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+	Candidate candidate;
+	for (std::size_t b = 0; b < _blocks.size(); ++b)
+		if (bestCandidate(b, candidate))
+			queue.push(candidate);
+
+	while (totalBytes > _maxBytes)
+	{
+		if (queue.empty())
+			throw std::string("The decomposition does not fit into " + std::to_string(_maxBytes) + " bytes.");
+		const Candidate next = queue.top();
+		queue.pop();
+		--ranks[next.block][next.mode];
+		totalBytes -= next.savedBytes;
+		if (bestCandidate(next.block, candidate))
+			queue.push(candidate);
+	}
+
+	return ranks;
+}
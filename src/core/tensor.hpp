@@ -1,15 +1,624 @@
 #pragma once
 
+#include "allocator.hpp"
 #include <Eigen/Eigen>
 #include <unsupported/Eigen/KroneckerProduct>
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
+namespace details {
+	// Type in which arithmetic on a storage type is done.
+	// Reduced precision types are widened to float.
+	template<typename Scalar>
+	struct ComputeTypeImpl { using type = Scalar; };
+	template<>
+	struct ComputeTypeImpl<Eigen::half> { using type = float; };
+	template<>
+	struct ComputeTypeImpl<Eigen::bfloat16> { using type = float; };
+
+	template<typename Scalar>
+	using ComputeType = typename ComputeTypeImpl<std::remove_const_t<Scalar>>::type;
+
+	// Number of elements processed by one task of the parallel kernels.
+	constexpr std::ptrdiff_t PARALLEL_CHUNK = std::ptrdiff_t(1) << 14;
+
+	// Calls _fn(begin, count) for consecutive chunks of [0, _numElements) in parallel.
+	template<typename Fn>
+	void parallelFor(std::ptrdiff_t _numElements, Fn _fn)
+	{
+		const std::ptrdiff_t numChunks = (_numElements + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+#pragma omp parallel for if(numChunks > 1)
+		for (std::ptrdiff_t c = 0; c < numChunks; ++c)
+		{
+			const std::ptrdiff_t begin = c * PARALLEL_CHUNK;
+			_fn(begin, std::min(PARALLEL_CHUNK, _numElements - begin));
+		}
+	}
+
+	// Like parallelFor, but returns the sum of all _fn results.
+	template<typename Fn>
+	double parallelSum(std::ptrdiff_t _numElements, Fn _fn)
+	{
+		const std::ptrdiff_t numChunks = (_numElements + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+		double sum = 0.0;
+#pragma omp parallel for reduction(+:sum) if(numChunks > 1)
+		for (std::ptrdiff_t c = 0; c < numChunks; ++c)
+		{
+			const std::ptrdiff_t begin = c * PARALLEL_CHUNK;
+			sum += _fn(begin, std::min(PARALLEL_CHUNK, _numElements - begin));
+		}
+		return sum;
+	}
+
+	// Parallel std::copy with an explicit conversion of the elements
+	template<typename SrcScalar, typename DstScalar>
+	void convertCopy(const SrcScalar* _begin, const SrcScalar* _end, DstScalar* _dst) noexcept
+	{
+		parallelFor(_end - _begin, [=](std::ptrdiff_t _first, std::ptrdiff_t _count)
+			{
+				if constexpr (std::is_same_v<std::remove_const_t<SrcScalar>, DstScalar>)
+					std::copy(_begin + _first, _begin + _first + _count, _dst + _first);
+				else
+					std::transform(_begin + _first, _begin + _first + _count, _dst + _first,
+						[](SrcScalar x) { return static_cast<DstScalar>(x); });
+			});
+	}
+
+	// Edge length of the square tiles in which blocks are transposed.
+	// 16 floats fill exactly one cache line.
+	constexpr std::ptrdiff_t TRANSPOSE_TILE = 16;
+
+	// Transposed copy of a block: _dst(j, i) = _src(i, j) for i < _rows, j < _cols.
+	// Element (r, c) of a block is located at r * rowStride + c * colStride.
+	// The copy is done in tiles so that both sides stay in cache, regardless of which one
+	// is accessed contiguously.
+	template<typename DstScalar, typename SrcScalar>
+	void transposeBlock(DstScalar* _dst, std::ptrdiff_t _dstRowStride, std::ptrdiff_t _dstColStride,
+		const SrcScalar* _src, std::ptrdiff_t _srcRowStride, std::ptrdiff_t _srcColStride,
+		std::ptrdiff_t _rows, std::ptrdiff_t _cols) noexcept
+	{
+		for (std::ptrdiff_t i0 = 0; i0 < _rows; i0 += TRANSPOSE_TILE)
+		{
+			const std::ptrdiff_t iEnd = std::min(i0 + TRANSPOSE_TILE, _rows);
+			for (std::ptrdiff_t j0 = 0; j0 < _cols; j0 += TRANSPOSE_TILE)
+			{
+				const std::ptrdiff_t jEnd = std::min(j0 + TRANSPOSE_TILE, _cols);
+				for (std::ptrdiff_t i = i0; i < iEnd; ++i)
+				{
+					DstScalar* dst = _dst + i * _dstColStride;
+					const SrcScalar* src = _src + i * _srcRowStride;
+					for (std::ptrdiff_t j = j0; j < jEnd; ++j)
+						dst[j * _dstRowStride] = static_cast<DstScalar>(src[j * _srcColStride]);
+				}
+			}
+		}
+	}
+
+	// Splits the k-unfolding of a strided tensor into blocks of consecutive columns.
+	// Each block is a (run x size[_k]) matrix in the tensor, where the run consists of all
+	// modes before _k which can be merged into a single stride.
+	// @param _fn Invoked as _fn(offset, firstColumn, runLength, runStride) for every block,
+	//	where offset is the position of the block in the tensor.
+	// @param _parallel Distribute ranges of blocks across threads; _fn has to be safe to call
+	//	concurrently.
+	template<std::size_t Order, typename Fn>
+	void forEachUnfoldingBlock(const std::array<int, Order>& _size,
+		const std::array<std::ptrdiff_t, Order>& _strides,
+		int _k,
+		Fn _fn,
+		bool _parallel = false)
+	{
+		int numMerged = 0;
+		std::ptrdiff_t runLength = 1;
+		std::ptrdiff_t runStride = 1;
+		if (_k > 0)
+		{
+			numMerged = 1;
+			runLength = _size[0];
+			runStride = _strides[0];
+			while (numMerged < _k && _strides[numMerged] == runStride * runLength)
+			{
+				runLength *= _size[numMerged];
+				++numMerged;
+			}
+		}
+
+		std::size_t numBlocks = 1;
+		for (int j = numMerged; j < static_cast<int>(Order); ++j)
+			if (j != _k) numBlocks *= _size[j];
+
+		// odometer over all remaining modes except _k, starting at block _begin
+		auto processBlocks = [&](std::size_t _begin, std::size_t _end)
+		{
+			std::array<int, Order> ind{};
+			std::ptrdiff_t offset = 0;
+			std::size_t remainder = _begin;
+			for (int j = numMerged; j < static_cast<int>(Order); ++j)
+			{
+				if (j == _k) continue;
+				ind[j] = static_cast<int>(remainder % _size[j]);
+				remainder /= _size[j];
+				offset += ind[j] * _strides[j];
+			}
+
+			std::size_t column = _begin * runLength;
+			for (std::size_t b = _begin; b < _end; ++b)
+			{
+				_fn(offset, column, runLength, runStride);
+				column += runLength;
+
+				for (int j = numMerged; j < static_cast<int>(Order); ++j)
+				{
+					if (j == _k) continue;
+					offset += _strides[j];
+					if (++ind[j] < _size[j]) break;
+					offset -= _strides[j] * _size[j];
+					ind[j] = 0;
+				}
+			}
+		};
+
+		const std::ptrdiff_t numElements = static_cast<std::ptrdiff_t>(numBlocks) * runLength * _size[_k];
+		const std::ptrdiff_t numTasks = _parallel
+			? std::min(static_cast<std::ptrdiff_t>(numBlocks), (numElements + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK)
+			: 1;
+#pragma omp parallel for if(numTasks > 1)
+		for (std::ptrdiff_t t = 0; t < numTasks; ++t)
+			processBlocks(numBlocks * t / numTasks, numBlocks * (t + 1) / numTasks);
+	}
+
+	// Writes the k-unfolding of the strided tensor _src into the column-major matrix _dst
+	// of size (size[_k] x numElements / size[_k]).
+	template<typename DstScalar, typename SrcScalar, std::size_t Order>
+	void unfold(DstScalar* _dst, const SrcScalar* _src,
+		const std::array<int, Order>& _size,
+		const std::array<std::ptrdiff_t, Order>& _strides,
+		int _k)
+	{
+		const std::ptrdiff_t rows = _size[_k];
+		const std::ptrdiff_t strideK = _strides[_k];
+		forEachUnfoldingBlock<Order>(_size, _strides, _k,
+			[=](std::ptrdiff_t _offset, std::size_t _column, std::ptrdiff_t _length, std::ptrdiff_t _stride)
+			{
+				transposeBlock(_dst + _column * rows, 1, rows,
+					_src + _offset, _stride, strideK,
+					_length, rows);
+			}, true);
+	}
+
+	// Inverse of unfold; sets the strided tensor _dst from the k-unfolding _src.
+	template<typename DstScalar, typename SrcScalar, std::size_t Order>
+	void fold(DstScalar* _dst, const SrcScalar* _src,
+		const std::array<int, Order>& _size,
+		const std::array<std::ptrdiff_t, Order>& _strides,
+		int _k)
+	{
+		const std::ptrdiff_t rows = _size[_k];
+		const std::ptrdiff_t strideK = _strides[_k];
+		forEachUnfoldingBlock<Order>(_size, _strides, _k,
+			[=](std::ptrdiff_t _offset, std::size_t _column, std::ptrdiff_t _length, std::ptrdiff_t _stride)
+			{
+				transposeBlock(_dst + _offset, _stride, strideK,
+					_src + _column * rows, 1, rows,
+					rows, _length);
+			}, true);
+	}
+
+	// Calls _fn(index) for the first element of every mode-0 fiber of a tensor with size _size.
+	template<std::size_t Order, typename Fn>
+	void forEachFiber(const std::array<int, Order>& _size, Fn _fn)
+	{
+		std::size_t numFibers = 1;
+		for (std::size_t j = 1; j < Order; ++j)
+			numFibers *= _size[j];
+
+		std::array<int, Order> ind{};
+		for (std::size_t f = 0; f < numFibers; ++f)
+		{
+			_fn(static_cast<const std::array<int, Order>&>(ind));
+			for (std::size_t j = 1; j < Order; ++j)
+			{
+				if (++ind[j] < _size[j]) break;
+				ind[j] = 0;
+			}
+		}
+	}
+
+	// Calls _fn(index, flatIndex) for all elements whose last index is in [_outerBegin, _outerEnd)
+	// in memory order. The multi-index is incremented odometer-style instead of being
+	// computed from the flat index.
+	template<std::size_t Order, typename Fn>
+	void forEachIndex(const std::array<int, Order>& _size, int _outerBegin, int _outerEnd, Fn _fn)
+	{
+		std::size_t outerStride = 1;
+		for (std::size_t j = 0; j + 1 < Order; ++j)
+			outerStride *= _size[j];
+		if (_outerBegin >= _outerEnd || !outerStride)
+			return;
+
+		std::array<int, Order> ind{};
+		const std::array<int, Order>& cind = ind;
+		std::size_t flat = outerStride * _outerBegin;
+		if constexpr (Order == 1)
+		{
+			for (ind[0] = _outerBegin; ind[0] < _outerEnd; ++ind[0])
+				_fn(cind, flat++);
+		}
+		else
+		{
+			ind[Order - 1] = _outerBegin;
+			for (;;)
+			{
+				for (ind[0] = 0; ind[0] < _size[0]; ++ind[0])
+					_fn(cind, flat++);
+
+				std::size_t j = 1;
+				for (; j < Order - 1; ++j)
+				{
+					if (++ind[j] < _size[j]) break;
+					ind[j] = 0;
+				}
+				if (j == Order - 1 && ++ind[j] == _outerEnd)
+					return;
+			}
+		}
+	}
+
+	template<std::size_t Order, typename Fn>
+	void forEachIndex(const std::array<int, Order>& _size, Fn _fn)
+	{
+		forEachIndex(_size, 0, _size[Order - 1], _fn);
+	}
+
+	// Like forEachIndex, but the outermost mode is split across threads.
+	// _fn has to be safe to call concurrently.
+	template<std::size_t Order, typename Fn>
+	void parallelForEachIndex(const std::array<int, Order>& _size, Fn _fn)
+	{
+		std::ptrdiff_t numElements = 1;
+		for (int s : _size)
+			numElements *= s;
+		const int outer = _size[Order - 1];
+#pragma omp parallel for schedule(static) if(numElements > PARALLEL_CHUNK && outer > 1)
+		for (int i = 0; i < outer; ++i)
+			forEachIndex(_size, i, i + 1, _fn);
+	}
+}
+
+// @param Allocator Policy from memory:: which provides the storage.
+template<typename Scalar, int Order, typename Allocator = memory::AlignedAllocator>
+class Tensor;
+
+// Lazy element-wise expression over tensors of the same size.
+// Wraps an Eigen expression on the vectorizations, so that e.g. (a - b).norm() is
+// evaluated in a single vectorized pass without a temporary tensor.
+// Operands are referenced, thus an expression has to be evaluated before they go out of scope.
+template<typename Expr, int Order>
+class TensorExpression
+{
+public:
+	using Scalar = typename Expr::Scalar;
+	using SizeVector = std::array<int, Order>;
+
+	TensorExpression(const Expr& _expr, const SizeVector& _size)
+		: m_expr(_expr), m_size(_size)
+	{}
+
+	const Expr& expr() const noexcept { return m_expr; }
+	const SizeVector& size() const noexcept { return m_size; }
+	std::size_t numElements() const noexcept { return static_cast<std::size_t>(m_expr.size()); }
+
+	template<typename Allocator>
+	void evalTo(Tensor<Scalar, Order, Allocator>& _tensor) const
+	{
+		_tensor.resize(m_size);
+		Scalar* dst = _tensor.data();
+		details::parallelFor(m_expr.size(), [&](std::ptrdiff_t _begin, std::ptrdiff_t _count)
+			{
+				Eigen::Map<Eigen::VectorX<Scalar>>(dst + _begin, _count) = m_expr.segment(_begin, _count);
+			});
+	}
+
+	Tensor<Scalar, Order> eval() const
+	{
+		Tensor<Scalar, Order> tensor;
+		evalTo(tensor);
+		return tensor;
+	}
+
+	// Sum of squares, accumulated in double precision.
+	double squaredNorm() const
+	{
+		return details::parallelSum(m_expr.size(), [&](std::ptrdiff_t _begin, std::ptrdiff_t _count)
+			{
+				return m_expr.segment(_begin, _count).template cast<double>().squaredNorm();
+			});
+	}
+
+	// Frobenius Norm
+	Scalar norm() const { return static_cast<Scalar>(std::sqrt(squaredNorm())); }
+private:
+	Expr m_expr;
+	SizeVector m_size;
+};
+
+namespace details {
+	template<typename T>
+	struct IsTensorOperand : std::false_type {};
+	template<typename Scalar, int Order, typename Allocator>
+	struct IsTensorOperand<Tensor<Scalar, Order, Allocator>> : std::true_type {};
+	template<typename Expr, int Order>
+	struct IsTensorOperand<TensorExpression<Expr, Order>> : std::true_type {};
+
+	template<typename A, typename B = A>
+	using EnableTensorOperands = std::enable_if_t<IsTensorOperand<A>::value && IsTensorOperand<B>::value>;
+
+	template<typename Scalar, int Order, typename Allocator>
+	auto asExpression(const Tensor<Scalar, Order, Allocator>& _tensor) { return _tensor.expr(); }
+	template<typename Expr, int Order>
+	const TensorExpression<Expr, Order>& asExpression(const TensorExpression<Expr, Order>& _expr) { return _expr; }
+
+	template<typename A, typename B, typename Op>
+	auto combine(const A& _a, const B& _b, Op _op)
+	{
+		const auto a = asExpression(_a);
+		const auto b = asExpression(_b);
+		assert(a.size() == b.size());
+		const auto expr = _op(a.expr(), b.expr());
+		return TensorExpression<std::decay_t<decltype(expr)>, std::tuple_size_v<std::decay_t<decltype(a.size())>>>(
+			expr, a.size());
+	}
+}
+
+// Element-wise arithmetic on tensors and expressions; the result is lazy.
+template<typename A, typename B, typename = details::EnableTensorOperands<A, B>>
+auto operator+(const A& _a, const B& _b)
+{
+	return details::combine(_a, _b, [](const auto& a, const auto& b) { return a + b; });
+}
+
+template<typename A, typename B, typename = details::EnableTensorOperands<A, B>>
+auto operator-(const A& _a, const B& _b)
+{
+	return details::combine(_a, _b, [](const auto& a, const auto& b) { return a - b; });
+}
+
+template<typename A, typename = details::EnableTensorOperands<A>>
+auto operator*(typename std::decay_t<decltype(details::asExpression(std::declval<const A&>()))>::Scalar _alpha,
+	const A& _a)
+{
+	const auto a = details::asExpression(_a);
+	const auto expr = _alpha * a.expr();
+	return TensorExpression<std::decay_t<decltype(expr)>, std::tuple_size_v<std::decay_t<decltype(a.size())>>>(
+		expr, a.size());
+}
+
+// Inner product of the vectorizations, accumulated in double precision.
+template<typename A, typename B, typename = details::EnableTensorOperands<A, B>>
+double dot(const A& _a, const B& _b)
+{
+	const auto a = details::asExpression(_a);
+	const auto b = details::asExpression(_b);
+	assert(a.size() == b.size());
+	return details::parallelSum(a.expr().size(), [&](std::ptrdiff_t _begin, std::ptrdiff_t _count)
+		{
+			return a.expr().segment(_begin, _count).template cast<double>()
+				.dot(b.expr().segment(_begin, _count).template cast<double>());
+		});
+}
+
+// Frobenius norm of (_a - _b) without materializing the difference.
+template<typename A, typename B, typename = details::EnableTensorOperands<A, B>>
+double distance(const A& _a, const B& _b)
+{
+	return std::sqrt((_a - _b).squaredNorm());
+}
+
+// _y += _alpha * _x
+template<typename Scalar, int Order, typename Allocator, typename X,
+	typename = details::EnableTensorOperands<X>>
+void axpy(Scalar _alpha, const X& _x, Tensor<Scalar, Order, Allocator>& _y)
+{
+	const auto x = details::asExpression(_x);
+	assert(x.size() == _y.size());
+	Scalar* y = _y.data();
+	details::parallelFor(x.expr().size(), [&](std::ptrdiff_t _begin, std::ptrdiff_t _count)
+		{
+			Eigen::Map<Eigen::VectorX<Scalar>>(y + _begin, _count) += _alpha * x.expr().segment(_begin, _count);
+		});
+}
+
+// _x *= _alpha
+template<typename Scalar, int Order, typename Allocator>
+void scale(Scalar _alpha, Tensor<Scalar, Order, Allocator>& _x)
+{
+	Scalar* x = _x.data();
+	details::parallelFor(static_cast<std::ptrdiff_t>(_x.numElements()), [&](std::ptrdiff_t _begin, std::ptrdiff_t _count)
+		{
+			Eigen::Map<Eigen::VectorX<Scalar>>(x + _begin, _count) *= _alpha;
+		});
+}
+
+// Non-owning view of a tensor with arbitrary strides.
+// A read-only view has a const Scalar, e.g. TensorView<const float, 4>.
 template<typename Scalar, int Order>
+class TensorView
+{
+public:
+	using ValueType = std::remove_const_t<Scalar>;
+	using ComputeScalar = details::ComputeType<Scalar>;
+	using SizeVector = std::array<int, Order>;
+	using StrideVector = std::array<std::ptrdiff_t, Order>;
+
+	TensorView(Scalar* _data, const SizeVector& _size, const StrideVector& _strides) noexcept
+		: m_data(_data), m_size(_size), m_strides(_strides)
+	{}
+
+	// view of densely stored data in column-major order
+	TensorView(Scalar* _data, const SizeVector& _size) noexcept
+		: m_data(_data), m_size(_size)
+	{
+		std::ptrdiff_t stride = 1;
+		for (int i = 0; i < Order; ++i)
+		{
+			m_strides[i] = stride;
+			stride *= m_size[i];
+		}
+	}
+
+	// mutable views convert to read-only views
+	template<typename OthScalar, typename = std::enable_if_t<
+		!std::is_same_v<OthScalar, Scalar> && std::is_same_v<const OthScalar, Scalar>>>
+	TensorView(const TensorView<OthScalar, Order>& _oth) noexcept
+		: m_data(_oth.data()), m_size(_oth.size()), m_strides(_oth.strides())
+	{}
+
+	// Restrict the view to the indices [_begin, _begin + _count) in dimension _mode.
+	TensorView slice(int _mode, int _begin, int _count) const noexcept
+	{
+		assert(_begin >= 0 && _count >= 0 && _begin + _count <= m_size[_mode]);
+
+		TensorView view = *this;
+		view.m_data += _begin * m_strides[_mode];
+		view.m_size[_mode] = _count;
+		return view;
+	}
+
+	// Restrict the view to a single index in dimension _mode.
+	TensorView slice(int _mode, int _index) const noexcept { return slice(_mode, _index, 1); }
+
+	// index access
+	Scalar& operator[](const SizeVector& _index) const noexcept { return m_data[offset(_index)]; }
+
+	Scalar* data() const noexcept { return m_data; }
+	constexpr int order() const noexcept { return Order; }
+	const SizeVector& size() const noexcept { return m_size; }
+	const StrideVector& strides() const noexcept { return m_strides; }
+	std::size_t numElements() const noexcept
+	{
+		std::size_t n = 1;
+		for (int s : m_size) n *= s;
+		return n;
+	}
+
+	// True if the elements are stored densely in column-major order.
+	bool isContiguous() const noexcept
+	{
+		std::ptrdiff_t stride = 1;
+		for (int i = 0; i < Order; ++i)
+		{
+			if (m_size[i] > 1 && m_strides[i] != stride) return false;
+			stride *= m_size[i];
+		}
+		return true;
+	}
+
+	std::ptrdiff_t offset(const SizeVector& _index) const noexcept
+	{
+		std::ptrdiff_t off = 0;
+		for (int i = 0; i < Order; ++i)
+			off += _index[i] * m_strides[i];
+		return off;
+	}
+
+	Eigen::MatrixX<ComputeScalar> flatten(int _k) const
+	{
+		Eigen::MatrixX<ComputeScalar> m(m_size[_k], numElements() / m_size[_k]);
+
+		if (isContiguous() && _k == 0)
+			details::convertCopy(m_data, m_data + numElements(), m.data());
+		else
+			details::unfold(m.data(), m_data, m_size, m_strides, _k);
+
+		return m;
+	}
+
+	template<int K>
+	Eigen::MatrixX<ComputeScalar> flatten() const
+	{
+		static_assert(K < Order);
+		return flatten(K);
+	}
+
+	// set from a k-flattening
+	void set(const Eigen::MatrixX<ComputeScalar>& _flatTensor, int _k) const
+	{
+		static_assert(!std::is_const_v<Scalar>, "Can not write to a read-only view.");
+		assert(_flatTensor.rows() == m_size[_k]);
+		assert(static_cast<std::size_t>(_flatTensor.size()) == numElements());
+
+		details::fold(m_data, _flatTensor.data(), m_size, m_strides, _k);
+	}
+
+	Tensor<ValueType, Order> operator-(const TensorView<const ValueType, Order>& _oth) const
+	{
+		assert(m_size == _oth.size());
+
+		Tensor<ValueType, Order> tensor(m_size);
+		// parallel over the outermost mode
+		const int numSlices = m_size[Order - 1];
+		const std::size_t sliceElements = numSlices ? numElements() / numSlices : 0;
+#pragma omp parallel for if(numElements() > details::PARALLEL_CHUNK)
+		for (int j = 0; j < numSlices; ++j)
+		{
+			const TensorView a = slice(Order - 1, j);
+			const TensorView<const ValueType, Order> b = _oth.slice(Order - 1, j);
+			ValueType* dst = tensor.data() + j * sliceElements;
+			details::forEachFiber(a.size(), [&](const SizeVector& _index)
+				{
+					const Scalar* aFiber = a.data() + a.offset(_index);
+					const ValueType* bFiber = b.data() + b.offset(_index);
+					for (int i = 0; i < m_size[0]; ++i)
+						*dst++ = aFiber[i * m_strides[0]] - bFiber[i * b.strides()[0]];
+				});
+		}
+
+		return tensor;
+	}
+
+	// Frobenius Norm, accumulated in double precision
+	ValueType norm() const noexcept
+	{
+		double s = 0;
+		const int numSlices = m_size[Order - 1];
+#pragma omp parallel for reduction(+:s) if(numElements() > details::PARALLEL_CHUNK)
+		for (int j = 0; j < numSlices; ++j)
+		{
+			const TensorView a = slice(Order - 1, j);
+			details::forEachFiber(a.size(), [&](const SizeVector& _index)
+				{
+					const Scalar* fiber = a.data() + a.offset(_index);
+					for (int i = 0; i < m_size[0]; ++i)
+					{
+						const double x = static_cast<ComputeScalar>(fiber[i * m_strides[0]]);
+						s += x * x;
+					}
+				});
+		}
+
+		return static_cast<ValueType>(std::sqrt(s));
+	}
+private:
+	Scalar* m_data;
+	SizeVector m_size;
+	StrideVector m_strides;
+};
+
+template<typename Scalar, int Order, typename Allocator>
 class Tensor
 {
+	static_assert(std::is_trivially_copyable_v<Scalar>
+		&& std::is_trivially_destructible_v<Scalar>,
+		"Elements are stored in uninitialized memory.");
 public:
+	// Scalar is the storage type; flattenings are in ComputeScalar.
+	using ComputeScalar = details::ComputeType<Scalar>;
 	using SizeVector = std::array<int, Order>;
 
 	Tensor() noexcept : m_size{}, m_offsets{}, m_numElements(0), m_capacity(0), m_data(nullptr) {}
@@ -22,14 +631,40 @@ public:
 			* static_cast<size_t>(m_size.back());
 		m_capacity = m_numElements;
 
-		m_data = std::make_unique<Scalar[]>(m_numElements);
+		m_data = allocate(m_numElements);
 	}
 
+	// @param _data If not null, elements are copied from it; otherwise they are uninitialized.
 	Tensor(const SizeVector& _size, const Scalar* _data)
 		: Tensor(_size)
 	{
 		if (_data)
-			std::copy(_data, _data + m_numElements, m_data.get());
+			details::convertCopy(_data, _data + m_numElements, m_data.get());
+	}
+
+	// Wraps external memory instead of allocating.
+	// The tensor does not free _data but keeps _owner alive as long as it uses the memory.
+	Tensor(const SizeVector& _size, Scalar* _data, std::shared_ptr<const void> _owner)
+		: m_size(_size),
+		m_data(_data, memory::Deallocate<Allocator>{ std::move(_owner) })
+	{
+		computeOffsets();
+		m_numElements = static_cast<size_t>(m_offsets.back())
+			* static_cast<size_t>(m_size.back());
+		m_capacity = m_numElements;
+	}
+
+	template<typename Expr>
+	Tensor(const TensorExpression<Expr, Order>& _expr)
+		: Tensor()
+	{
+		_expr.evalTo(*this);
+	}
+
+	explicit Tensor(const TensorView<const Scalar, Order>& _view)
+		: Tensor(_view.size())
+	{
+		details::unfold(m_data.get(), _view.data(), m_size, _view.strides(), 0);
 	}
 
 	Tensor(const Tensor& _oth)
@@ -37,9 +672,9 @@ public:
 		m_offsets(_oth.m_offsets),
 		m_numElements(_oth.m_numElements),
 		m_capacity(_oth.m_numElements),
-		m_data(std::make_unique<Scalar[]>(m_numElements))
+		m_data(allocate(m_numElements))
 	{
-		std::copy(_oth.m_data.get(), _oth.m_data.get() + m_numElements, m_data.get());
+		details::convertCopy(_oth.m_data.get(), _oth.m_data.get() + m_numElements, m_data.get());
 	}
 
 	Tensor(Tensor&& _oth) noexcept
@@ -50,17 +685,18 @@ public:
 		m_data(std::move(_oth.m_data))
 	{}
 
-	template<typename StreamT>
+	template<typename StreamT, typename = decltype(std::declval<StreamT&>().read(nullptr, 0))>
 	explicit Tensor(StreamT& _stream)
 	{
 		_stream.read(reinterpret_cast<char*>(m_size.data()), m_size.size() * sizeof(int));
+		_stream.ignore(memory::alignmentPadding(static_cast<std::size_t>(_stream.tellg())));
 
 		computeOffsets();
 		m_numElements = static_cast<size_t>(m_offsets.back())
 			* static_cast<size_t>(m_size.back());
 		m_capacity = m_numElements;
 
-		m_data = std::make_unique<Scalar[]>(m_numElements);
+		m_data = allocate(m_numElements);
 
 		_stream.read(reinterpret_cast<char*>(m_data.get()), m_numElements * sizeof(Scalar));
 	}
@@ -71,9 +707,16 @@ public:
 		m_offsets = _oth.m_offsets;
 		m_numElements = _oth.m_numElements;
 		m_capacity = m_numElements;
-		m_data = std::make_unique<Scalar[]>(m_numElements);
-		std::copy(_oth.m_data.get(), _oth.m_data.get() + m_numElements, m_data.get());
+		m_data = allocate(m_numElements);
+		details::convertCopy(_oth.m_data.get(), _oth.m_data.get() + m_numElements, m_data.get());
+
+		return *this;
+	}
 
+	template<typename Expr>
+	Tensor& operator=(const TensorExpression<Expr, Order>& _expr)
+	{
+		_expr.evalTo(*this);
 		return *this;
 	}
 
@@ -89,93 +732,92 @@ public:
 	}
 
 	// set from a k-flattening
-	void set(const Eigen::MatrixX<Scalar>& _flatTensor, int _k)
+	void set(const Eigen::MatrixX<ComputeScalar>& _flatTensor, int _k)
 	{
 		assert(_flatTensor.rows() == m_size[_k]);
 		assert(_flatTensor.rows() * _flatTensor.cols() == m_numElements);
 
-		for (size_t i = 0; i < m_numElements; ++i)
-		{
-			const auto& [indK, indOth] = decomposeFlatIndex(i, _k);
-			m_data[i] = _flatTensor(indK, indOth);
-		}
+		if (_k == 0)
+			details::convertCopy(_flatTensor.data(), _flatTensor.data() + m_numElements, m_data.get());
+		else
+			details::fold(m_data.get(), _flatTensor.data(), m_size, strides(), _k);
 	}
 
 	//set from a k-flattening with K known at compile time
 	template<int K>
-	void set(const Eigen::MatrixX<Scalar>& _flatTensor) noexcept
+	void set(const Eigen::MatrixX<ComputeScalar>& _flatTensor) noexcept
 	{
 		static_assert(K < Order);
 		assert(_flatTensor.rows() == m_size[K]);
 		assert(_flatTensor.rows() * _flatTensor.cols() == m_numElements);
 
 		if constexpr (K == 0)
-		{
-			std::copy(_flatTensor.data(), _flatTensor.data() + m_numElements, m_data.get());
-			return;
-		}
-
-		for (size_t i = 0; i < m_numElements; ++i)
-		{
-			const auto& [indK, indOth] = decomposeFlatIndex<K>(i);
-			m_data[i] = _flatTensor(indK, indOth);
-		}
+			details::convertCopy(_flatTensor.data(), _flatTensor.data() + m_numElements, m_data.get());
+		else
+			details::fold(m_data.get(), _flatTensor.data(), m_size, strides(), K);
 	}
 
-
-
+	// Assigns _generator(index) to every element, visited in memory order.
 	template<typename Gen>
 	void set(Gen _generator)
 	{
-		for(size_t i = 0; i < m_numElements; ++i)
-			m_data[i] = _generator(index(i));
+		details::forEachIndex(m_size, [&](const SizeVector& _index, std::size_t _flat)
+			{
+				m_data[_flat] = _generator(_index);
+			});
+	}
+
+	// Like set(Gen), but the generator is called concurrently and in no particular order.
+	template<typename Gen>
+	void setParallel(Gen _generator)
+	{
+		details::parallelForEachIndex(m_size, [&](const SizeVector& _index, std::size_t _flat)
+			{
+				m_data[_flat] = _generator(_index);
+			});
 	}
 
-	void append(const Tensor<Scalar, Order>& _tensor)
+	// Concatenates _tensor along the last mode.
+	void append(const Tensor& _tensor)
 	{
 		for (int i = 0; i < Order - 1; ++i)
 			if (m_size[i] != _tensor.size()[i])
 				throw std::string("Incompatible tensor sizes.");
 
-		reserve(m_numElements + _tensor.numElements());
-		std::copy(_tensor.data(), _tensor.data() + _tensor.numElements(), m_data.get() + m_numElements);
+		// grow geometrically so that repeated appends take amortized linear time
+		const std::size_t required = m_numElements + _tensor.numElements();
+		if (required > m_capacity)
+			reserve(std::max(required, 2 * m_capacity));
+		details::convertCopy(_tensor.data(), _tensor.data() + _tensor.numElements(), m_data.get() + m_numElements);
 		m_size.back() += _tensor.size().back();
 		m_numElements += _tensor.numElements();
 	}
 
-	Eigen::MatrixX<Scalar> flatten(int _k) const
+	Eigen::MatrixX<ComputeScalar> flatten(int _k) const
 	{
 		const size_t othDim = m_numElements / m_size[_k];
-		Eigen::MatrixX<Scalar> m(m_size[_k], othDim);
+		Eigen::MatrixX<ComputeScalar> m(m_size[_k], othDim);
 
-		for (size_t i = 0; i < m_numElements; ++i)
-		{
-			const auto& [indK, indOth] = decomposeFlatIndex(i, _k);
-			m(indK, indOth) = m_data[i];
-		}
+		if (_k == 0)
+			details::convertCopy(m_data.get(), m_data.get() + m_numElements, m.data());
+		else
+			details::unfold(m.data(), m_data.get(), m_size, strides(), _k);
 
 		return m;
 	}
 
 	// If K is known at compile time use this.
 	template<int K>
-	Eigen::MatrixX<Scalar> flatten() const
+	Eigen::MatrixX<ComputeScalar> flatten() const
 	{
+		static_assert(K < Order);
 		const size_t othDim = m_numElements / m_size[K];
-		Eigen::MatrixX<Scalar> m(m_size[K], othDim);
+		Eigen::MatrixX<ComputeScalar> m(m_size[K], othDim);
 
 		if constexpr (K == 0)
-		{
-			std::copy(m_data.get(), m_data.get() + m_numElements, m.data());
-		}
+			details::convertCopy(m_data.get(), m_data.get() + m_numElements, m.data());
 		else
-		{
-			for (size_t i = 0; i < m_numElements; ++i)
-			{
-				const auto& [indK, indOth] = decomposeFlatIndex<K>(i);
-				m(indK, indOth) = m_data[i];
-			}
-		}
+			details::unfold(m.data(), m_data.get(), m_size, strides(), K);
 
 		return m;
 	}
@@ -194,7 +836,7 @@ public:
 
 		if (m_capacity < m_numElements || (_shrink && oldNum > m_numElements))
 		{
-			m_data = std::make_unique<Scalar[]>(m_numElements);
+			m_data = allocate(m_numElements);
 			m_capacity = m_numElements;
 		}
 	}
@@ -205,22 +847,32 @@ public:
 	{
 		if (_capacity <= m_capacity) return;
 
-		Scalar* newData = new float[_capacity];
-		std::copy(m_data.get(), m_data.get() + m_numElements, newData);
-		m_data.reset(newData);
+		Storage newData = allocate(_capacity);
+		details::convertCopy(m_data.get(), m_data.get() + m_numElements, newData.get());
+		m_data = std::move(newData);
 		m_capacity = _capacity;
 	}
 
 	// ACCESS OPERATIONS
 
 	// vectorization
-	Eigen::Map<const Eigen::VectorX<Scalar>> vec() const noexcept
+	Eigen::Map<const Eigen::VectorX<Scalar>, Eigen::Aligned64> vec() const noexcept
+	{
+		return { m_data.get(), static_cast<Eigen::Index>(m_numElements) };
+	}
+	Eigen::Map<Eigen::VectorX<Scalar>, Eigen::Aligned64> vec() noexcept
 	{
 		return { m_data.get(), static_cast<Eigen::Index>(m_numElements) };
 	}
 
+	// lazy expression for element-wise arithmetic
+	auto expr() const noexcept
+	{
+		return TensorExpression<Eigen::Map<const Eigen::VectorX<Scalar>, Eigen::Aligned64>, Order>(vec(), m_size);
+	}
+
 	// view which is equivalent to the 0-flattening
-	Eigen::Map<const Eigen::MatrixX<Scalar>> mat() const noexcept
+	Eigen::Map<const Eigen::MatrixX<Scalar>, Eigen::Aligned64> mat() const noexcept
 	{
 		return { m_data.get(),
 			static_cast<Eigen::Index>(m_size[0]),
@@ -231,23 +883,41 @@ public:
 	Scalar& operator[](const SizeVector& _index) noexcept { return m_data[flatIndex(_index)]; }
 	Scalar operator[](const SizeVector& _index) const noexcept { return m_data[flatIndex(_index)]; }
 
+	// non-owning views
+	TensorView<Scalar, Order> view() noexcept { return { m_data.get(), m_size }; }
+	TensorView<const Scalar, Order> view() const noexcept { return { m_data.get(), m_size }; }
+	operator TensorView<const Scalar, Order>() const noexcept { return view(); }
+
+	TensorView<Scalar, Order> slice(int _mode, int _begin, int _count) noexcept
+	{
+		return view().slice(_mode, _begin, _count);
+	}
+	TensorView<const Scalar, Order> slice(int _mode, int _begin, int _count) const noexcept
+	{
+		return view().slice(_mode, _begin, _count);
+	}
+
 	// raw access to the underlying memory
 	Scalar* data() noexcept { return m_data.get(); }
 	const Scalar* data() const noexcept { return m_data.get(); }
 
 	constexpr int order() const noexcept { return Order; }
 	const SizeVector& size() const noexcept { return m_size; }
+	// distance in memory between consecutive elements in each dimension
+	std::array<std::ptrdiff_t, Order> strides() const noexcept
+	{
+		std::array<std::ptrdiff_t, Order> s;
+		for (int i = 0; i < Order; ++i)
+			s[i] = m_offsets[i];
+		return s;
+	}
 	const std::size_t numElements() const noexcept { return m_numElements; }
 
 	template<int OthOrder>
-	bool isSameSize(const Tensor<Scalar, OthOrder>& _oth) const noexcept
+	bool isSameSize(const Tensor<Scalar, OthOrder, Allocator>& _oth) const noexcept
 	{
-		if constexpr(OthOrder != Order) return false;
-
-		for (int i = 0; i < Order; ++i)
-			if (m_size[i] != _oth.m_size[i]) return false;
-
-		return true;
+		if constexpr (OthOrder != Order) return false;
+		else return m_size == _oth.size();
 	}
 
 	bool operator==(const Tensor& _oth) const noexcept
@@ -258,40 +928,16 @@ public:
 	}
 
 	// ARITHMETIC OPERATORS
-	Tensor<Scalar, Order> operator+(const Tensor<Scalar, Order>& _oth) const
+	// Element-wise operations with other tensors are provided as lazy TensorExpressions.
+	Tensor<Scalar, Order> operator-(const TensorView<const Scalar, Order>& _oth) const
 	{
-		assert(isSameSize(_oth));
-
-		Tensor<Scalar, Order> tensor(m_size);
-		for (size_t i = 0; i < m_numElements; ++i)
-		{
-			tensor.m_data[i] = m_data[i] + _oth.m_data[i];
-		}
-
-		return tensor;
-	}
-
-	Tensor<Scalar, Order> operator-(const Tensor<Scalar, Order>& _oth) const
-	{
-		assert(isSameSize(_oth));
-
-		Tensor<Scalar, Order> tensor(m_size);
-		for (size_t i = 0; i < m_numElements; ++i)
-		{
-			tensor.m_data[i] = m_data[i] - _oth.m_data[i];
-		}
-
-		return tensor;
+		return view() - _oth;
 	}
 
-	// Frobenius Norm
-	Scalar norm() const noexcept
+	// Frobenius Norm, accumulated in double precision
+	Scalar norm() const
 	{
-		Scalar s = 0;
-		for (size_t i = 0; i < m_numElements; ++i)
-			s += m_data[i] * m_data[i];
-
-		return std::sqrt(s);
+		return expr().norm();
 	}
 
 	size_t flatIndex(const SizeVector& _index) const noexcept
@@ -326,10 +972,50 @@ public:
 	void save(StreamT& _stream) const
 	{
 		_stream.write(reinterpret_cast<const char*>(m_size.data()), m_size.size() * sizeof(int));
+		// the data is aligned so that it can be mapped in place
+		constexpr char padding[memory::ALIGNMENT] = {};
+		_stream.write(padding, memory::alignmentPadding(static_cast<std::size_t>(_stream.tellp())));
 		_stream.write(reinterpret_cast<const char*>(m_data.get()), 
 			m_numElements * sizeof(Scalar));
 	}
+
+	// Creates a tensor in place from the output of save() without copying the elements.
+	// @param _ptr Position of the serialized tensor in memory aligned like the stream;
+	//	is advanced past the tensor.
+	// @param _end End of the memory; a tensor which does not fit throws.
+	// @param _owner Keeps the memory alive.
+	static Tensor mapSerialized(char*& _ptr, const char* _end, std::shared_ptr<const void> _owner)
+	{
+		SizeVector size;
+		if (_end - _ptr < static_cast<std::ptrdiff_t>(size.size() * sizeof(int)))
+			throw std::string("Unexpected end of a serialized tensor.");
+		std::memcpy(size.data(), _ptr, size.size() * sizeof(int));
+		_ptr += size.size() * sizeof(int);
+		_ptr += memory::alignmentPadding(reinterpret_cast<std::uintptr_t>(_ptr));
+
+		const std::size_t available = _ptr < _end ? static_cast<std::size_t>(_end - _ptr) / sizeof(Scalar) : 0;
+		std::size_t numElements = 1;
+		for (int s : size)
+		{
+			if (s < 0 || (s > 0 && numElements > available / s))
+				throw std::string("Unexpected end of a serialized tensor.");
+			numElements *= s;
+		}
+
+		Tensor tensor(size, reinterpret_cast<Scalar*>(_ptr), std::move(_owner));
+		_ptr += tensor.numElements() * sizeof(Scalar);
+		return tensor;
+	}
 private:
+	template<typename, int, typename>
+	friend class Tensor;
+
+	using Storage = std::unique_ptr<Scalar[], memory::Deallocate<Allocator>>;
+
+	static Storage allocate(std::size_t _numElements)
+	{
+		return Storage(static_cast<Scalar*>(Allocator::allocate(_numElements * sizeof(Scalar))));
+	}
 
 	void computeOffsets() noexcept
 	{
@@ -340,107 +1026,239 @@ private:
 		}
 	}
 
-	// Compute new indices for a k-flattening from a flatIndex.
-	std::pair<size_t, size_t> decomposeFlatIndex(size_t flatIndex, int _k) const noexcept
-	{
-		SizeVector ind{};
-		size_t reminder = flatIndex;
+	SizeVector m_size;
+	SizeVector m_offsets; // cumulative sizes
+	std::size_t m_numElements;
+	std::size_t m_capacity;
+	Storage m_data;
+};
 
-		std::size_t flatInd = 0;
-		std::size_t dimSize = 1;
-		for (int j = 0; j < _k; ++j)
+// Mode-k product _dst = _matrix x_k _src, computed without building the k-unfolding.
+// Since the tensors are stored column-major, every slab of the modes 0..k is a
+// (size[0]*...*size[k-1]) x size[k] matrix and the product is a batch of GEMMs on these.
+// Tensors with a reduced precision storage type are widened to Scalar one slab at a time.
+// @param _dst Is resized as needed and may not alias _src.
+// @param _transpose If true, the matrix is multiplied transposed with the tensor.
+template<typename Derived, typename SrcScalar, int Order, typename DstScalar, typename Allocator>
+void modeProduct(const Eigen::MatrixBase<Derived>& _matrix,
+	const TensorView<const SrcScalar, Order>& _src,
+	Tensor<DstScalar, Order, Allocator>& _dst,
+	int _k,
+	bool _transpose = false)
+{
+	using Scalar = typename Derived::Scalar;
+	using MatrixMap = Eigen::Map<Eigen::MatrixX<DstScalar>>;
+	using ConstMatrixMap = Eigen::Map<const Eigen::MatrixX<SrcScalar>>;
+	using SlabMap = Eigen::Map<Eigen::MatrixX<DstScalar>, 0, Eigen::OuterStride<>>;
+	using ConstSlabMap = Eigen::Map<const Eigen::MatrixX<SrcScalar>, 0, Eigen::OuterStride<>>;
+	using ConstStridedMap = Eigen::Map<const Eigen::MatrixX<SrcScalar>, 0,
+		Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+	constexpr bool SAME_SRC = std::is_same_v<SrcScalar, Scalar>;
+	constexpr bool SAME_DST = std::is_same_v<DstScalar, Scalar>;
+
+	const Eigen::Index srcRows = _src.size()[_k];
+	const Eigen::Index dstRows = _transpose ? _matrix.cols() : _matrix.rows();
+	assert((_transpose ? _matrix.rows() : _matrix.cols()) == srcRows);
+	assert(static_cast<const void*>(_src.data()) != static_cast<const void*>(_dst.data()));
+
+	auto sizeVec = _src.size();
+	sizeVec[_k] = static_cast<int>(dstRows);
+	_dst.resize(sizeVec);
+
+	auto gemm = [&](const auto& x, auto&& y)
+	{
+		if (_k == 0)
+		{
+			if (_transpose)
+				y.noalias() = _matrix.transpose() * x;
+			else
+				y.noalias() = _matrix * x;
+		}
+		else
 		{
-			ind[j] = reminder % m_size[j];
-			reminder /= m_size[j];
+			if (_transpose)
+				y.noalias() = x * _matrix;
+			else
+				y.noalias() = x * _matrix.transpose();
+		}
+	};
 
-			flatInd += dimSize * ind[j];
-			dimSize *= m_size[j];
+	auto multiply = [&](const auto& x, auto&& y)
+	{
+		if constexpr (SAME_SRC && SAME_DST)
+			gemm(x, y);
+		else
+		{
+			const Eigen::MatrixX<Scalar> xs = x.template cast<Scalar>();
+			if constexpr (SAME_DST)
+				gemm(xs, y);
+			else
+			{
+				Eigen::MatrixX<Scalar> ys(y.rows(), y.cols());
+				gemm(xs, ys);
+				y = ys.template cast<DstScalar>();
+			}
 		}
+	};
 
-		ind[_k] = reminder % m_size[_k];
-		reminder /= m_size[_k];
+	if (_k == 0)
+	{
+		const Eigen::Index cols = static_cast<Eigen::Index>(_src.numElements() / srcRows);
+		MatrixMap y(_dst.data(), dstRows, cols);
+		if (!_src.isContiguous())
+			multiply(_src.flatten(0), y);
+		else if constexpr (SAME_SRC && SAME_DST)
+			multiply(ConstMatrixMap(_src.data(), srcRows, cols), y);
+		else
+		{
+			// limit the size of the widened copies
+			const Eigen::Index blockCols = std::max<Eigen::Index>(1, details::PARALLEL_CHUNK / srcRows);
+			for (Eigen::Index c = 0; c < cols; c += blockCols)
+			{
+				const Eigen::Index n = std::min(blockCols, cols - c);
+				multiply(ConstMatrixMap(_src.data() + c * srcRows, srcRows, n), y.middleCols(c, n));
+			}
+		}
+		return;
+	}
 
-		flatInd += reminder * dimSize;
+	// Each block of the unfolding is a (length x srcRows) matrix in the source
+	// which maps to a slab with leading dimension inner in the destination.
+	const Eigen::Index inner = _dst.strides()[_k];
+	const Eigen::Index strideK = _src.strides()[_k];
+	details::forEachUnfoldingBlock(_src.size(), _src.strides(), _k,
+		[&](std::ptrdiff_t _offset, std::size_t _column, std::ptrdiff_t _length, std::ptrdiff_t _stride)
+		{
+			const Eigen::Index column = static_cast<Eigen::Index>(_column);
+			SlabMap y(_dst.data() + column % inner + (column / inner) * inner * dstRows,
+				_length, dstRows, Eigen::OuterStride<>(inner));
+			if (_stride == 1)
+				multiply(ConstSlabMap(_src.data() + _offset, _length, srcRows,
+					Eigen::OuterStride<>(strideK)), y);
+			else
+				multiply(ConstStridedMap(_src.data() + _offset, _length, srcRows,
+					Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(strideK, _stride)), y);
+		});
+}
 
-		return { ind[_k], flatInd };
-	}
+template<typename Derived, typename SrcScalar, int Order, typename SrcAllocator,
+	typename DstScalar, typename Allocator>
+void modeProduct(const Eigen::MatrixBase<Derived>& _matrix,
+	const Tensor<SrcScalar, Order, SrcAllocator>& _src,
+	Tensor<DstScalar, Order, Allocator>& _dst,
+	int _k,
+	bool _transpose = false)
+{
+	modeProduct(_matrix, _src.view(), _dst, _k, _transpose);
+}
 
-	// variant for compile time K
-	template<int K>
-	std::pair<size_t, size_t> decomposeFlatIndex(size_t flatIndex) const noexcept
+namespace details {
+	// Number of operations and largest intermediate number of elements of a multilinear
+	// product which processes the modes in the given order.
+	template<typename MatrixT, std::size_t OrderS>
+	std::pair<double, double> multilinearProductCost(const std::array<MatrixT, OrderS>& _matrices,
+		const std::array<int, OrderS>& _order,
+		bool _transpose)
 	{
-		static_assert(K < Order);
+		double numElements = 1.0;
+		for (const auto& m : _matrices)
+			numElements *= static_cast<double>(_transpose ? m.rows() : m.cols());
 
-		SizeVector ind{};
-		size_t reminder = flatIndex;
-
-		std::size_t flatInd = 0;
-		std::size_t dimSize = 1;
-		for (int j = 0; j < K; ++j)
+		double flops = 0.0;
+		double peak = 0.0;
+		for (int k : _order)
 		{
-			ind[j] = reminder % m_size[j];
-			reminder /= m_size[j];
-
-			flatInd += dimSize * ind[j];
-			dimSize *= m_size[j];
+			const double in = static_cast<double>(_transpose ? _matrices[k].rows() : _matrices[k].cols());
+			const double out = static_cast<double>(_transpose ? _matrices[k].cols() : _matrices[k].rows());
+			flops += 2.0 * numElements * out;
+			numElements = numElements / in * out;
+			peak = std::max(peak, numElements);
 		}
-
-		ind[K] = reminder % m_size[K];
-		reminder /= m_size[K];
-
-		flatInd += reminder * dimSize;
-
-		return { ind[K], flatInd };
+		return { flops, peak };
 	}
+}
 
-	SizeVector m_size;
-	SizeVector m_offsets; // cumulative sizes
-	std::size_t m_numElements;
-	std::size_t m_capacity;
-	std::unique_ptr<Scalar[]> m_data;
-};
+// Order of the mode products with the fewest operations for multilinearProduct;
+// ties are broken by the size of the largest intermediate tensor.
+template<typename MatrixT, std::size_t OrderS>
+std::array<int, OrderS> optimalProductOrder(const std::array<MatrixT, OrderS>& _matrices,
+	bool _transpose = false)
+{
+	std::array<int, OrderS> order;
+	for (std::size_t k = 0; k < OrderS; ++k)
+		order[k] = static_cast<int>(k);
 
-namespace details {
-	template<int K, typename Scalar, int Order, std::size_t OrderA>
-	void multilinearProductImpl(const std::array<Eigen::MatrixX<Scalar>, OrderA>& _matrices,
-		Tensor<Scalar, Order>& _tensor,
-		bool _transpose)
+	std::array<int, OrderS> best = order;
+	auto bestCost = details::multilinearProductCost(_matrices, order, _transpose);
+	while (std::next_permutation(order.begin(), order.end()))
 	{
-		static_assert(Order == OrderA);
+		const auto cost = details::multilinearProductCost(_matrices, order, _transpose);
+		if (cost < bestCost)
 		{
-			Eigen::MatrixX<Scalar> flat = _tensor.template flatten<K>();
-			if (_transpose)
-				flat = _matrices[K].transpose() * flat;
-			else
-				flat = _matrices[K] * flat;
-
-			auto sizeVec = _tensor.size();
-			sizeVec[K] = static_cast<int>(flat.rows());
-			_tensor.resize(sizeVec);
-			_tensor.template set<K>(flat);
+			bestCost = cost;
+			best = order;
 		}
-		if constexpr (K < Order - 1)
-			details::multilinearProductImpl<K + 1>(_matrices, _tensor, _transpose);
 	}
+	return best;
 }
 
-// Multilinear product via k-flattening
+// Multilinear product via a sequence of mode-k products
+// The result has the scalar type of the matrices, even if _tensor is stored in reduced precision.
+// @param _matrices Eigen matrices or maps.
+// @param _order Permutation of the modes in which the products are computed.
 // @param _transpose If true, the matrices are multiplied transposed with the tensor.
-template<typename Scalar, int Order, std::size_t OrderS>
-auto multilinearProduct(const std::array<Eigen::MatrixX<Scalar>, OrderS>& _matrices,
-	const Tensor<Scalar, Order>& _tensor,
+template<typename MatrixT, typename SrcScalar, int Order, std::size_t OrderS>
+auto multilinearProduct(const std::array<MatrixT, OrderS>& _matrices,
+	const TensorView<const SrcScalar, Order>& _tensor,
+	const std::array<int, OrderS>& _order,
 	bool _transpose = false)
-	-> Tensor<Scalar, Order>
+	-> Tensor<typename MatrixT::Scalar, Order>
 {
 	static_assert(OrderS == Order);
+	using Scalar = typename MatrixT::Scalar;
 
-	auto result = _tensor;
+	Tensor<Scalar, Order> result;
+	modeProduct(_matrices[_order[0]], _tensor, result, _order[0], _transpose);
 
-	details::multilinearProductImpl<0>(_matrices, result, _transpose);
+	Tensor<Scalar, Order> buffer;
+	for (std::size_t i = 1; i < OrderS; ++i)
+	{
+		modeProduct(_matrices[_order[i]], result, buffer, _order[i], _transpose);
+		std::swap(result, buffer);
+	}
 
 	return result;
 }
 
+// Computes the mode products in the order given by optimalProductOrder.
+template<typename MatrixT, typename SrcScalar, int Order, std::size_t OrderS>
+auto multilinearProduct(const std::array<MatrixT, OrderS>& _matrices,
+	const TensorView<const SrcScalar, Order>& _tensor,
+	bool _transpose = false)
+	-> Tensor<typename MatrixT::Scalar, Order>
+{
+	return multilinearProduct(_matrices, _tensor, optimalProductOrder(_matrices, _transpose), _transpose);
+}
+
+template<typename MatrixT, typename SrcScalar, int Order, typename Allocator, std::size_t OrderS>
+auto multilinearProduct(const std::array<MatrixT, OrderS>& _matrices,
+	const Tensor<SrcScalar, Order, Allocator>& _tensor,
+	const std::array<int, OrderS>& _order,
+	bool _transpose = false)
+	-> Tensor<typename MatrixT::Scalar, Order>
+{
+	return multilinearProduct(_matrices, _tensor.view(), _order, _transpose);
+}
+
+template<typename MatrixT, typename SrcScalar, int Order, typename Allocator, std::size_t OrderS>
+auto multilinearProduct(const std::array<MatrixT, OrderS>& _matrices,
+	const Tensor<SrcScalar, Order, Allocator>& _tensor,
+	bool _transpose = false)
+	-> Tensor<typename MatrixT::Scalar, Order>
+{
+	return multilinearProduct(_matrices, _tensor.view(), _transpose);
+}
+
 // Multilinear product via Kronecker product
 // This method requires massive amounts of memory and should not be used.
 template<typename Scalar>
@@ -108,4 +108,45 @@ namespace truncation {
 			return static_cast<size_t>(_k) < rank.size() ? rank[_k] : rank.back();
 		}
 	};
+
+	// Bounds the relative error ||X - X'|| / ||X|| of the decomposition by eps.
+	// The squared error of a (sequentially truncated) HOSVD is at most the sum of the squared
+	// singular values discarded in all modes, so each mode may discard eps^2 / numModes of the
+	// energy of its unfolding. The energy only decreases during the sequential truncation,
+	// thus the bound also holds for hosvdInterlaced. It does not hold for IncrementalTucker,
+	// which truncates again on every update, so the discarded energy accumulates.
+	struct RelativeError
+	{
+		explicit RelativeError(double _eps, int _numModes = 4) : eps(_eps), numModes(_numModes) {}
+
+		// Bound which achieves at least the given peak signal-to-noise ratio in dB.
+		// @param _squaredNorm, _numElements Of the tensor to decompose.
+		// @param _peak Largest possible value of an element.
+		static RelativeError fromPSNR(double _psnr, double _squaredNorm, std::size_t _numElements,
+			double _peak = 1.0, int _numModes = 4)
+		{
+			const double maxSquaredError = _peak * _peak * std::pow(10.0, -_psnr / 10.0) * _numElements;
+			return RelativeError(_squaredNorm > 0.0 ? std::sqrt(maxSquaredError / _squaredNorm) : 0.0, _numModes);
+		}
+
+		double eps;
+		int numModes;
+
+		template<typename Scalar>
+		Eigen::Index operator() (const Eigen::VectorX<Scalar>& _singularValues, int) const noexcept
+		{
+			const double budget = eps * eps * _singularValues.template cast<double>().squaredNorm() / numModes;
+
+			Eigen::Index rank = _singularValues.size();
+			double discarded = 0.0;
+			for (; rank > 0; --rank)
+			{
+				const double s = _singularValues[rank - 1];
+				if (discarded + s * s > budget)
+					break;
+				discarded += s * s;
+			}
+			return rank;
+		}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "hosvd.hpp"
+#include <vector>
+
+// Tensor in tensor-train format:
+// T(i_0, ..., i_{d-1}) = G_0(:, i_0, :) * G_1(:, i_1, :) * ... * G_{d-1}(:, i_{d-1}, :),
+// where core G_k has size (r_{k-1} x n_k x r_k) and r_{-1} = r_{d-1} = 1.
+// The storage grows linearly with the order, so tensors can be split into many small modes.
+// The order is only known at runtime; decode() reshapes the result as needed.
+template<typename Scalar>
+class TensorTrain
+{
+public:
+	using Core = Tensor<Scalar, 3>;
+
+	TensorTrain() = default;
+	explicit TensorTrain(std::vector<Core> _cores) : m_cores(std::move(_cores)) {}
+
+	const std::vector<Core>& cores() const noexcept { return m_cores; }
+	std::vector<Core>& cores() noexcept { return m_cores; }
+	int order() const noexcept { return static_cast<int>(m_cores.size()); }
+
+	// size n_k of every mode
+	std::vector<int> modes() const
+	{
+		std::vector<int> modes;
+		modes.reserve(m_cores.size());
+		for (const Core& core : m_cores)
+			modes.push_back(core.size()[1]);
+		return modes;
+	}
+
+	// inner ranks r_0, ..., r_{d-2}
+	std::vector<int> ranks() const
+	{
+		std::vector<int> ranks;
+		for (std::size_t k = 0; k + 1 < m_cores.size(); ++k)
+			ranks.push_back(m_cores[k].size()[2]);
+		return ranks;
+	}
+
+	std::size_t numParameters() const noexcept
+	{
+		std::size_t num = 0;
+		for (const Core& core : m_cores)
+			num += core.numElements();
+		return num;
+	}
+
+	// Contracts the train to the full tensor.
+	// @param _size Any size with the same number of elements as the modes of the train.
+	template<std::size_t Order>
+	Tensor<Scalar, static_cast<int>(Order)> decode(const std::array<int, Order>& _size) const
+	{
+		using namespace Eigen;
+
+		// left part of the train as a (n_0 * ... * n_k) x r_k matrix
+		const Core& first = m_cores.front();
+		MatrixX<Scalar> left = Map<const MatrixX<Scalar>>(first.data(), first.size()[1], first.size()[2]);
+		MatrixX<Scalar> product;
+		for (std::size_t k = 1; k < m_cores.size(); ++k)
+		{
+			const Core& core = m_cores[k];
+			const Index rank = core.size()[0];
+			const Index rows = left.rows();
+			product.noalias() = left * Map<const MatrixX<Scalar>>(core.data(), rank,
+				static_cast<Index>(core.size()[1]) * core.size()[2]);
+			// column-major, so (rows x (n_k * r_k)) is also ((rows * n_k) x r_k)
+			left = Map<const MatrixX<Scalar>>(product.data(), rows * core.size()[1], core.size()[2]);
+		}
+
+		Tensor<Scalar, static_cast<int>(Order)> tensor(_size);
+		if (static_cast<std::size_t>(left.size()) != tensor.numElements())
+			throw std::string("Incompatible tensor sizes.");
+		details::convertCopy(left.data(), left.data() + left.size(), tensor.data());
+		return tensor;
+	}
+
+	template<typename StreamT>
+	void save(StreamT& _stream) const
+	{
+		const int numCores = order();
+		_stream.write(reinterpret_cast<const char*>(&numCores), sizeof(int));
+		for (const Core& core : m_cores)
+			core.save(_stream);
+	}
+private:
+	std::vector<Core> m_cores;
+};
+
+namespace details {
+	// Splits every mode into factors of at most _maxModeSize, smallest prime factors first.
+	// Prime factors larger than _maxModeSize remain a mode of their own.
+	template<std::size_t Order>
+	std::vector<int> quantizedModes(const std::array<int, Order>& _size, int _maxModeSize)
+	{
+		std::vector<int> modes;
+		for (int n : _size)
+		{
+			int mode = 1;
+			for (int p = 2; n > 1; )
+			{
+				if (n % p)
+				{
+					p = p * p > n ? n : p + 1;
+					continue;
+				}
+				if (mode * p > _maxModeSize && mode > 1)
+				{
+					modes.push_back(mode);
+					mode = 1;
+				}
+				mode *= p;
+				n /= p;
+			}
+			modes.push_back(mode);
+		}
+		return modes;
+	}
+}
+
+// TT-SVD: Computes a tensor train by successive truncated SVDs of the unfoldings
+// (r_{k-1} * n_k) x (n_{k+1} * ... * n_{d-1}).
+// Tensors in a reduced precision storage type are decomposed in their ComputeType.
+// @param _modes Sizes of the modes of the train; the tensor is reshaped accordingly in
+//	column-major order. Use details::quantizedModes to split large modes.
+// @param _truncate Applied to the singular values of each unfolding, where _k is the bond index.
+template<typename Scalar, int Order, typename Truncate = truncation::Zero,
+	typename ComputeScalar = details::ComputeType<Scalar>>
+TensorTrain<ComputeScalar> ttSvd(const Tensor<Scalar, Order>& _tensor,
+	const std::vector<int>& _modes,
+	const Truncate& _truncate = truncation::Zero(),
+	SVDMethod _method = SVDMethod::Auto)
+{
+	using namespace Eigen;
+	using Core = typename TensorTrain<ComputeScalar>::Core;
+
+	std::size_t numElements = 1;
+	for (int n : _modes)
+		numElements *= n;
+	if (numElements != _tensor.numElements())
+		throw std::string("Incompatible tensor sizes.");
+
+	std::vector<Core> cores;
+	cores.reserve(_modes.size());
+
+	// remainder of the train which still has to be decomposed, (rank * n_k) x rest
+	MatrixX<ComputeScalar> remainder = _tensor.flatten(0);
+	Index rank = 1;
+	Index rest = static_cast<Index>(numElements);
+	details::LeftSVD<ComputeScalar> svd;
+	for (std::size_t k = 0; k + 1 < _modes.size(); ++k)
+	{
+		const Index rows = rank * _modes[k];
+		rest /= _modes[k];
+		const Map<const MatrixX<ComputeScalar>> unfolding(remainder.data(), rows, rest);
+		svd.compute(unfolding, _method);
+
+		const Index newRank = std::max(Index(1), std::min(_truncate(svd.singularValues(), static_cast<int>(k)),
+			svd.rank()));
+		const MatrixX<ComputeScalar> U = svd.matrixU().leftCols(newRank);
+		cores.emplace_back(typename Core::SizeVector{ static_cast<int>(rank), _modes[k], static_cast<int>(newRank) },
+			U.data());
+
+		remainder = U.transpose() * unfolding;
+		rank = newRank;
+	}
+	cores.emplace_back(typename Core::SizeVector{ static_cast<int>(rank), _modes.back(), 1 }, remainder.data());
+
+	return TensorTrain<ComputeScalar>(std::move(cores));
+}
+
+// TT-SVD with the modes of the tensor.
+template<typename Scalar, int Order, typename Truncate = truncation::Zero,
+	typename ComputeScalar = details::ComputeType<Scalar>>
+TensorTrain<ComputeScalar> ttSvd(const Tensor<Scalar, Order>& _tensor,
+	const Truncate& _truncate = truncation::Zero(),
+	SVDMethod _method = SVDMethod::Auto)
+{
+	return ttSvd(_tensor, std::vector<int>(_tensor.size().begin(), _tensor.size().end()), _truncate, _method);
+}
@@ -13,6 +13,8 @@
 #include <args.hxx>
 #include <filesystem>
 #include <thread>
+#include <map>
+#include <omp.h>
 
 // CRT's memory leak detection
 #ifndef NDEBUG 
@@ -97,7 +99,7 @@ void benchmarkTensor(const std::array<int, Dim>& _sizeVec)
 	std::cout << "multilinear product     \t" << std::chrono::duration<float>(end - start).count() << std::endl;
 
 	start = std::chrono::high_resolution_clock::now();
-	auto tensor3 = tensor - tensor2;
+	const Tensor<float, Dim> tensor3 = tensor - tensor2;
 	end = std::chrono::high_resolution_clock::now();
 	std::cout << "subtract                \t" << std::chrono::duration<float>(end - start).count() << std::endl;
 
@@ -105,6 +107,11 @@ void benchmarkTensor(const std::array<int, Dim>& _sizeVec)
 	sum += tensor3.norm();
 	end = std::chrono::high_resolution_clock::now();
 	std::cout << "norm                    \t" << std::chrono::duration<float>(end - start).count() << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	sum += static_cast<float>(distance(tensor, tensor2));
+	end = std::chrono::high_resolution_clock::now();
+	std::cout << "fused distance          \t" << std::chrono::duration<float>(end - start).count() << std::endl;
 	
 	std::cout << sum + C.norm();
 }
@@ -115,6 +122,7 @@ enum struct TruncationMode
 	Rank,
 	Tolerance,
 	ToleranceSum,
+	RelativeError,
 };
 
 const std::unordered_map<std::string, TruncationMode> TRUNCATION_NAMES =
@@ -123,6 +131,19 @@ const std::unordered_map<std::string, TruncationMode> TRUNCATION_NAMES =
 	{"rank", TruncationMode::Rank},
 	{"tolerance", TruncationMode::Tolerance},
 	{"tolerance_sum", TruncationMode::ToleranceSum},
+	{"relative_error", TruncationMode::RelativeError},
+} };
+
+enum struct Method
+{
+	HOSVD,
+	TT
+};
+
+const std::unordered_map<std::string, Method> METHOD_NAMES =
+{ {
+	{"hosvd", Method::HOSVD},
+	{"tt", Method::TT}
 } };
 
 enum struct PixelFormat 
@@ -169,9 +190,42 @@ int main(int argc, char** args)
 		PIXEL_FORMATS, PixelFormat::YUV444);
 	args::PositionalList<float> truncationThreshold(parser, "truncation threshold",
 		"values used for truncation in each dimension");
+	args::ValueFlag<double> targetPSNR(parser, "psnr",
+		"truncate each block such that its peak signal-to-noise ratio in dB is at least this value; replaces --trunc",
+		{ "psnr" });
+	args::ValueFlag<std::size_t> maxBytes(parser, "max bytes",
+		"reduce the ranks of all blocks together such that the .ten file takes at most this many bytes; the truncation is applied first",
+		{ "max_bytes" }, 0);
+	args::ValueFlag<size_t> frame(parser, "frame",
+		"only decode this frame; the output may be a .png image",
+		{ "frame" });
+	args::ValueFlag<std::string> region(parser, "x,y,width,height",
+		"only decode this region of the frames", { "roi" });
+	args::ValueFlag<int> downscale(parser, "factor",
+		"decode frames downscaled by this integer factor, e.g. for previews", { "downscale" }, 1);
 	args::ValueFlag<int> framesPerBlock(parser, "frames per block",
 		"number of frames combined to a single tensor; if 0, the whole video is used (larger blocks allow for better compression but reduce encode and decode performance)",
 		{ "block_size" }, 24);
+	args::Flag halfPrecision(parser, "half precision",
+		"store video blocks as 16 bit floats during encoding; halves the memory traffic at a small loss of accuracy",
+		{ "half" });
+	args::ValueFlag<int> oversampling(parser, "oversampling",
+		"with --trunc rank, use a randomized decomposition which samples this many additional directions; much faster for small ranks",
+		{ "randomized" });
+	args::ValueFlag<int> hooiIterations(parser, "hooi iterations",
+		"refine the decomposition of each block with at most this many HOOI iterations; gives a smaller error for the same ranks",
+		{ "hooi" }, 0);
+	args::ValueFlag<int> incrementalFrames(parser, "incremental frames",
+		"build the decomposition incrementally by adding this many frames at a time; memory then depends on the ranks instead of the block size",
+		{ "incremental" }, 0);
+	args::ValueFlag<int> warmStartIterations(parser, "warm start iterations",
+		"start each block from the bases of the previous block and refine them with this many subspace iterations; much faster for blocks of the same shot",
+		{ "warm_start" });
+	args::MapFlag<std::string, Method> method(parser, "method",
+		"decomposition used for compression", { "method" }, METHOD_NAMES, Method::HOSVD);
+	args::ValueFlag<int> maxModeSize(parser, "max mode size",
+		"with --method tt, modes of a block are split into factors of at most this size; 0 keeps the modes",
+		{ "tt_mode_size" }, 16);
 	args::ValueFlag<int> numThreads(parser, "max threads",
 		"maximum number of threads used during computations",
 		{ "num_threads" }, std::thread::hardware_concurrency() / 2);
@@ -204,13 +258,49 @@ int main(int argc, char** args)
 		return 1;
 	}
 
+	// x,y,width,height
+	std::array<int, 4> regionValues{};
+	if (region)
+	{
+		const std::string& str = args::get(region);
+		const char* ptr = str.data();
+		const char* const end = str.data() + str.size();
+		bool valid = true;
+		for (std::size_t i = 0; i < regionValues.size() && valid; ++i)
+		{
+			const auto [next, error] = std::from_chars(ptr, end, regionValues[i]);
+			// exactly four values separated by commas
+			const bool last = i + 1 == regionValues.size();
+			valid = error == std::errc() && (last ? next == end : next < end && *next == ',');
+			if (valid && !last)
+				ptr = next + 1;
+		}
+		if (!valid)
+		{
+			std::cerr << "[Error] Invalid region " << str << ", expected x,y,width,height.\n";
+			return 1;
+		}
+	}
+	if (args::get(method) == Method::TT && (region || downscale))
+	{
+		std::cerr << "[Error] --roi and --downscale are not supported with --method tt.\n";
+		return 1;
+	}
+	// the error bound only holds for a decomposition which is truncated once
+	if (args::get(method) == Method::HOSVD && args::get(incrementalFrames) > 0
+		&& (targetPSNR || args::get(truncationMode) == TruncationMode::RelativeError))
+	{
+		std::cerr << "[Error] --psnr and --trunc relative_error are not supported with --incremental.\n";
+		return 1;
+	}
+
+	// the same budget applies to Eigen's products and the tensor kernels
 	Eigen::setNbThreads(args::get(numThreads));
+	omp_set_num_threads(std::max(1, args::get(numThreads)));
 
-	auto process = [&](const auto& pixelFormat)
+	// truncation, encode or load, statistics and output are shared by all methods
+	auto run = [&](auto& compressor, auto printStats)
 	{
-		auto compressor = compression::HOSVDCompressor(pixelFormat);
-		compressor.setFramesPerBlock(args::get(framesPerBlock));
-
 		std::vector<float> rank = args::get(truncationThreshold);
 		if (rank.size() < 4)
 		{
@@ -236,9 +326,16 @@ int main(int argc, char** args)
 				rank.push_back(0.2f);
 			compressor.setTruncation(truncation::ToleranceSum(rank));
 			break;
+		case TruncationMode::RelativeError:
+			if (rank.empty())
+				rank.push_back(0.05f);
+			compressor.setTruncation(truncation::RelativeError(rank.front()));
+			break;
 		}
+		if (targetPSNR)
+			compressor.setTargetPSNR(args::get(targetPSNR));
 
-		if (inputPath.extension() == "ten")
+		if (inputPath.extension() == ".ten")
 		{
 			std::cout << "Loading tensor file " << args::get(inputFile) << ".\n";
 			compressor.load(args::get(inputFile));
@@ -247,56 +344,163 @@ int main(int argc, char** args)
 		{
 			std::cout << "Loading video " << args::get(inputFile) << ".\n";
 			Video video(args::get(inputFile));
-			std::cout << "Applying HOSVD.\n";
+			std::cout << "Compressing.\n";
 			compressor.encode(video);
 		}
 
-		struct Stats
-		{
-			int min = std::numeric_limits<int>::max();
-			int max = 0;
-			int sum = 0;
-		};
-		const auto& singularValues = compressor.singularValues();
-		std::vector<Stats> stats(singularValues.front().order());
-
-		for (auto s : singularValues)
-		{
-			for (size_t dim = 0; dim < s.size().size(); ++dim)
-			{
-				const int r = s.size()[dim];
-				stats[dim].min = std::min(stats[dim].min, r);
-				stats[dim].max = std::max(stats[dim].max, r);
-				stats[dim].sum += r;
-			}
-		}
-		std::cout << "Statistics of the resulting tensors: \n dimension\\rank min max mean\n";
-		for (auto& stat : stats)
-			std::cout << stat.min << " " << stat.max << " " << stat.sum / singularValues.size() << "\n";
+		printStats(compressor);
 
 		namespace fs = std::filesystem;
 		const fs::path outputPath = args::get(outputFile);
-		if (outputPath.extension() == "ten")
+		if (outputPath.extension() == ".ten")
 		{
 			std::cout << "Saving tensors as " << args::get(outputFile) << ".\n";
 			compressor.save(args::get(outputFile));
 		}
+		else if (frame)
+		{
+			std::cout << "Saving frame " << args::get(frame) << " as " << args::get(outputFile) << ".\n";
+			const Video video = compressor.decodeFrame(args::get(frame));
+			if (outputPath.extension() == ".png")
+				video.saveFrame(args::get(outputFile), 0);
+			else
+				video.save(args::get(outputFile));
+		}
 		else
 		{
 			std::cout << "Saving video as " << args::get(outputFile) << ".\n";
-			Video video = compressor.decode();
-			video.save(args::get(outputFile));
+			compressor.decode(args::get(outputFile));
 		}
 	};
 
-	switch (args::get(pixelFormat))
+	auto process = [&](const auto& pixelFormat)
 	{
-	case PixelFormat::RGB:
-		process(Video::RGB());
-		break;
-	case PixelFormat::YUV444:
-		process(Video::YUV444());
-		break;
+		if (args::get(method) == Method::TT)
+		{
+			compression::TTCompressor compressor(pixelFormat);
+			compressor.setFramesPerBlock(args::get(framesPerBlock));
+			compressor.setMaxModeSize(args::get(maxModeSize));
+			run(compressor, [](const auto& compressor)
+			{
+				const auto& trains = compressor.trains();
+				if (trains.empty())
+					return;
+				std::size_t numParameters = 0;
+				std::size_t maxRank = 0;
+				double rankSum = 0.0;
+				std::size_t numRanks = 0;
+				for (const auto& train : trains)
+				{
+					numParameters += train.numParameters();
+					for (int r : train.ranks())
+					{
+						maxRank = std::max(maxRank, static_cast<std::size_t>(r));
+						rankSum += r;
+						++numRanks;
+					}
+				}
+				std::cout << "Statistics of the resulting tensor trains: \n order " << trains.front().order()
+					<< "\n max rank " << maxRank << "\n mean rank " << rankSum / std::max<std::size_t>(numRanks, 1)
+					<< "\n parameters " << numParameters << "\n";
+			});
+		}
+		else
+		{
+			auto compressor = compression::HOSVDCompressor(pixelFormat);
+			compressor.setFramesPerBlock(args::get(framesPerBlock));
+			compressor.setReducedPrecision(args::get(halfPrecision));
+			if (oversampling)
+				compressor.setOversampling(args::get(oversampling));
+			compressor.setRefinement(args::get(hooiIterations));
+			compressor.setIncremental(std::max(0, args::get(incrementalFrames)));
+			compressor.setMaxBytes(args::get(maxBytes));
+			if (region)
+				compressor.setRegion(regionValues[0], regionValues[1], regionValues[2], regionValues[3]);
+			compressor.setDownscale(args::get(downscale));
+			if (warmStartIterations)
+				compressor.setWarmStart(args::get(warmStartIterations));
+
+			run(compressor, [](const auto& compressor)
+			{
+				struct Stats
+				{
+					int min = std::numeric_limits<int>::max();
+					int max = 0;
+					int sum = 0;
+				};
+				const auto& singularValues = compressor.singularValues();
+				std::vector<Stats> stats(singularValues.front().order());
+
+				for (auto s : singularValues)
+				{
+					for (size_t dim = 0; dim < s.size().size(); ++dim)
+					{
+						const int r = s.size()[dim];
+						stats[dim].min = std::min(stats[dim].min, r);
+						stats[dim].max = std::max(stats[dim].max, r);
+						stats[dim].sum += r;
+					}
+				}
+				std::cout << "Statistics of the resulting tensors: \n dimension\\rank min max mean\n";
+				for (auto& stat : stats)
+					std::cout << stat.min << " " << stat.max << " " << stat.sum / singularValues.size() << "\n";
+
+				std::map<std::array<int, 4>, int> modeOrders;
+				for (const auto& order : compressor.modeOrders())
+					++modeOrders[order];
+				for (const auto& [order, count] : modeOrders)
+					std::cout << "mode order " << order << " used for " << count << " blocks\n";
+
+				const WarmStartStats& warmStart = compressor.warmStartStats();
+				if (warmStart.numRefined + warmStart.numFallbacks > 0)
+					std::cout << "warm start: " << warmStart.numRefined << " bases refined, "
+						<< warmStart.numFallbacks << " full SVDs after a failed residual check\n";
+
+				// HOOI progress summed over all blocks that reached the iteration
+				struct IterationStats
+				{
+					int numBlocks = 0;
+					double error = 0.0;
+					double seconds = 0.0;
+				};
+				std::vector<IterationStats> refinement;
+				for (const auto& blockStats : compressor.refinementStats())
+				{
+					if (blockStats.size() > refinement.size())
+						refinement.resize(blockStats.size());
+					for (size_t i = 0; i < blockStats.size(); ++i)
+					{
+						++refinement[i].numBlocks;
+						refinement[i].error += blockStats[i].relativeError;
+						refinement[i].seconds += blockStats[i].seconds;
+					}
+				}
+				if (!refinement.empty())
+					std::cout << "HOOI iteration: blocks mean_relative_error time\n";
+				for (size_t i = 0; i < refinement.size(); ++i)
+					std::cout << i + 1 << ": " << refinement[i].numBlocks << " " << refinement[i].error / refinement[i].numBlocks
+						<< " " << refinement[i].seconds << "s\n";
+			});
+		}
+	};
+
+	// e.g. an invalid decode region or a .ten file of the other method
+	try
+	{
+		switch (args::get(pixelFormat))
+		{
+		case PixelFormat::RGB:
+			process(Video::RGB());
+			break;
+		case PixelFormat::YUV444:
+			process(Video::YUV444());
+			break;
+		}
+	}
+	catch (const std::string& e)
+	{
+		std::cerr << "[Error] " << e << "\n";
+		return 1;
 	}
 
 #if false
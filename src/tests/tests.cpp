@@ -1,8 +1,17 @@
 #include "tests.hpp"
 #include "../core/hosvd.hpp"
+#include "../core/incremental.hpp"
+#include "../core/tt.hpp"
+#include "../core/ratedistortion.hpp"
+#include "../core/compression.hpp"
+#include "../utils/boundedqueue.hpp"
+#include "../utils/mappedfile.hpp"
+#include <omp.h>
+#include <cstdio>
 #include <iostream>
 #include <random>
 #include <fstream>
+#include <thread>
 
 # define EXPECT(cond,description)										\
 do {																	\
@@ -64,17 +73,87 @@ void Tests::run()
 	EXPECT(fixTensor.index(fixTensor.flatIndex(index))
 		== index, "index computation");
 	EXPECT(fixTensor == fixTensor, "comparison operator");
+	{
+		Tensor<float, 4> indexTensor({ 3,1,5,70 });
+		indexTensor.setParallel([&](const auto& _index) { return static_cast<float>(indexTensor.flatIndex(_index)); });
+		bool consistent = true;
+		for (std::size_t i = 0; i < indexTensor.numElements(); ++i)
+			consistent &= indexTensor.data()[i] == static_cast<float>(i);
+		EXPECT(consistent, "parallel index iteration");
+	}
 	const auto smallTensor = randomTensor<3>({ 2,3,4 });
 	testFlattening<float, 3>(smallTensor);
 
+	{
+		Tensor<float, 3> appended(fixTensor.slice(2, 0, 1));
+		for (int i = 1; i < fixTensor.size()[2]; ++i)
+			appended.append(Tensor<float, 3>(fixTensor.slice(2, i, 1)));
+		EXPECT(appended == fixTensor, "append");
+	}
+
+	// expressions
+	const auto smallSum = randomTensor<3>({ 2,3,4 });
+	const Tensor<float, 3> combined = 2.f * smallTensor - smallSum + smallTensor;
+	EXPECT((combined.vec() - (3.f * smallTensor.vec() - smallSum.vec())).norm() < 0.0001f, "lazy expression");
+	EXPECT(std::abs(distance(smallTensor, smallSum) - (smallTensor.vec() - smallSum.vec()).norm()) < 0.0001f, "fused distance");
+	EXPECT(std::abs(dot(smallTensor, smallSum) - smallTensor.vec().dot(smallSum.vec())) < 0.0001f, "dot product");
+	Tensor<float, 3> axpyTensor = smallSum;
+	axpy(2.f, smallTensor, axpyTensor);
+	scale(0.5f, axpyTensor);
+	EXPECT(distance(axpyTensor, smallTensor + 0.5f * smallSum) < 0.0001f, "axpy and scale");
+
+	// allocation
+	EXPECT(reinterpret_cast<std::uintptr_t>(smallTensor.data()) % memory::ALIGNMENT == 0, "aligned storage");
+	{
+		memory::Arena arena(1024);
+		Tensor<float, 3, memory::ArenaAllocator> arenaTensor(smallTensor.size(), smallTensor.data());
+		arenaTensor.reserve(2 * arenaTensor.numElements());
+		EXPECT(arenaTensor.vec() == smallTensor.vec(), "arena allocation");
+		std::array<Eigen::MatrixX<float>, 3> identity;
+		for (int k = 0; k < 3; ++k)
+			identity[k].setIdentity(smallTensor.size()[k], smallTensor.size()[k]);
+		EXPECT((multilinearProduct(identity, arenaTensor) - smallTensor).norm() < 0.0001f, "arena multilinear product");
+	}
+
 	// save & load
-/*	std::ofstream outFile("test.tensor");
-	fixTensor.save(outFile);
-	outFile.close();
-	std::ifstream inFile("test.tensor");
-	const Tensor<float, 3> loadTensor(inFile);
-	EXPECT(loadTensor == fixTensor, "save and load");
-	*/
+	{
+		std::ofstream outFile("test.tensor", std::ios::binary);
+		outFile.write("x", 1); // misalign the tensor in the file
+		fixTensor.save(outFile);
+		outFile.close();
+		std::ifstream inFile("test.tensor", std::ios::binary);
+		inFile.ignore(1);
+		const Tensor<float, 3> loadTensor(inFile);
+		inFile.close();
+		EXPECT(loadTensor == fixTensor, "save and load");
+
+		const auto file = std::make_shared<MappedFile>("test.tensor");
+		char* ptr = file->data() + 1;
+		const char* const end = file->data() + file->size();
+		const Tensor<float, 3> mappedTensor = Tensor<float, 3>::mapSerialized(ptr, end, file);
+		EXPECT(mappedTensor == fixTensor && ptr == end, "mapped load");
+		EXPECT(reinterpret_cast<std::uintptr_t>(mappedTensor.data()) % memory::ALIGNMENT == 0, "mapped alignment");
+		bool overrun = false;
+		try
+		{
+			ptr = file->data() + 1;
+			Tensor<float, 3>::mapSerialized(ptr, end - sizeof(float), file);
+		}
+		catch (const std::string&)
+		{
+			overrun = true;
+		}
+		EXPECT(overrun, "truncated mapped load");
+	}
+	std::remove("test.tensor");
+	// mode-k product
+	const Eigen::MatrixX<float> modeMat = Eigen::MatrixX<float>::Random(5, 3);
+	Tensor<float, 3> modeProd;
+	modeProduct(modeMat, smallTensor, modeProd, 1);
+	Tensor<float, 3> modeProdRef(modeProd.size());
+	modeProdRef.set(modeMat * smallTensor.flatten(1), 1);
+	EXPECT((modeProd - modeProdRef).norm() < 0.0001f, "mode-k product");
+
 	// hosvd
 	const auto& [U, C] = hosvd(smallTensor);
 	auto smallT2 = multilinearProduct(U, C);
@@ -91,8 +170,392 @@ void Tests::run()
 	const auto& [U4, C4] = hosvdInterlaced(smallTensor, truncation::Rank(sizeVec));
 	EXPECT(sizeVec == C4.size(), "rank based truncation");
 
+	{
+		const auto wideTensor = randomTensor<4>({ 3,20,15,6 });
+		const truncation::Rank rank(Tensor<float, 4>::SizeVector{ 2,6,5,3 });
+		const auto& [UB, CB] = hosvdInterlaced(wideTensor, rank, SVDMethod::BDC);
+		const auto& [UG, CG] = hosvdInterlaced(wideTensor, rank, SVDMethod::Gram);
+		const float errorB = distance(wideTensor, multilinearProduct(UB, CB));
+		const float errorG = distance(wideTensor, multilinearProduct(UG, CG));
+		EXPECT(std::abs(errorB - errorG) < 0.001f * errorB, "gram matrix hosvd");
+	}
+	{
+		// low rank tensor plus noise
+		const auto lowRank = multilinearProduct(std::array<Eigen::MatrixX<float>, 3>{
+			Eigen::MatrixX<float>::Random(40, 3), Eigen::MatrixX<float>::Random(30, 4), Eigen::MatrixX<float>::Random(50, 5) },
+			randomTensor<3>({ 3,4,5 }));
+		const Tensor<float, 3> noisy = lowRank + 0.001f * randomTensor<3>({ 40,30,50 });
+		const truncation::Rank rank{ 3,4,5 };
+		const auto& [UR, CR] = hosvdRandomized(noisy, rank, 5);
+		const auto& [UI, CI] = hosvdInterlaced(noisy, rank);
+		EXPECT(CR.size() == CI.size(), "randomized hosvd rank");
+		const float errorR = distance(noisy, multilinearProduct(UR, CR));
+		const float errorI = distance(noisy, multilinearProduct(UI, CI));
+		EXPECT(errorR < 1.1f * errorI, "randomized hosvd");
+	}
+	{
+		const auto blockTensor = randomTensor<4>({ 3,40,30,20 });
+		const truncation::Rank rank{ 1,4,4,2 };
+		const std::array<int, 4> order = optimalModeOrder(blockTensor.size(), rank);
+		EXPECT(order != (std::array<int, 4>{ 0,1,2,3 }), "cost based mode order");
+		const auto& [UO, CO] = hosvdInterlaced(blockTensor, rank, order);
+		EXPECT(CO.size() == (std::array<int, 4>{ 1,4,4,2 }), "permuted hosvd");
+		const auto& [UN, CN] = hosvdInterlaced(blockTensor, truncation::Zero(), std::array<int, 4>{ 3,1,0,2 });
+		EXPECT(distance(blockTensor, multilinearProduct(UN, CN)) < 0.0001f * blockTensor.norm(), "permuted hosvd without truncation");
+	}
+	{
+		const auto hooiTensor = randomTensor<3>({ 12,10,8 });
+		auto [UH, CH] = hosvdInterlaced(hooiTensor, truncation::Rank{ 3,3,3 });
+		const double hosvdError = distance(hooiTensor, multilinearProduct(UH, CH));
+		const auto iterations = hooi(hooiTensor, UH, CH, 5, 0.0);
+		const double hooiError = distance(hooiTensor, multilinearProduct(UH, CH));
+		EXPECT(!iterations.empty() && hooiError <= hosvdError
+			&& std::abs(iterations.back().relativeError * hooiTensor.norm() - hooiError) < 0.001 * hooiError, "hooi refinement");
+	}
+	{
+		// exact low rank tensor, so the incremental decomposition is exact as well
+		const auto lowRank = multilinearProduct(std::array<Eigen::MatrixX<float>, 4>{
+			Eigen::MatrixX<float>::Random(3, 2), Eigen::MatrixX<float>::Random(20, 4),
+			Eigen::MatrixX<float>::Random(15, 3), Eigen::MatrixX<float>::Random(11, 3) },
+			randomTensor<4>({ 2,4,3,3 }));
+		const truncation::Rank rank{ 2,4,3,3 };
+		IncrementalTucker<float, 4, truncation::Rank> tucker(rank);
+		for (int i = 0; i < 11; i += 2)
+			tucker.add(lowRank.slice(3, i, std::min(2, 11 - i)));
+		const auto& [UT, CT] = tucker.finalize();
+		EXPECT(tucker.numSlices() == 11 && tucker.rank(3) == 3 && UT[3].rows() == 11
+			&& CT.size() == (std::array<int, 4>{ 2,4,3,3 }), "incremental tucker size");
+		EXPECT(distance(lowRank, multilinearProduct(UT, CT)) < 0.0001 * lowRank.norm(), "incremental tucker");
+	}
+	{
+		BoundedQueue<int> queue(2);
+		std::thread producer([&]()
+			{
+				for (int i = 1; i <= 100; ++i)
+					queue.push(i);
+				queue.close();
+			});
+		int sum = 0;
+		while (auto value = queue.pop())
+			sum += *value;
+		producer.join();
+		EXPECT(sum == 5050 && !queue.push(0), "bounded queue");
+	}
+	{
+		// decoding a block expands a small core
+		const std::array<Eigen::MatrixX<float>, 4> expand{ Eigen::MatrixX<float>::Random(3, 1),
+			Eigen::MatrixX<float>::Random(64, 6), Eigen::MatrixX<float>::Random(36, 5), Eigen::MatrixX<float>::Random(24, 25) };
+		const auto smallCore = randomTensor<4>({ 1,6,5,25 });
+		const auto productOrder = optimalProductOrder(expand);
+		EXPECT(details::multilinearProductCost(expand, productOrder, false).first
+			< details::multilinearProductCost(expand, { 0,1,2,3 }, false).first, "optimal product order");
+		const auto natural = multilinearProduct(expand, smallCore, { 0,1,2,3 });
+		EXPECT(distance(natural, multilinearProduct(expand, smallCore)) < 0.0001 * natural.norm()
+			&& distance(natural, multilinearProduct(expand, smallCore, { 3,1,0,2 })) < 0.0001 * natural.norm(), "ordered multilinear product");
+		// a single frame from a row of the temporal basis
+		const Eigen::MatrixX<float> frameRow = expand[3].row(7);
+		const auto frame = multilinearProduct(std::array<Eigen::MatrixX<float>, 4>{ expand[0], expand[1], expand[2], frameRow }, smallCore);
+		EXPECT(distance(frame, Tensor<float, 4>(natural.slice(3, 7, 1))) < 0.0001 * frame.norm(), "single frame decode");
+		// all modes but time expanded, as (pixels x rank) matrix times the temporal basis
+		const auto spatialTensor = multilinearProduct(std::array<Eigen::MatrixX<float>, 4>{ expand[0], expand[1], expand[2],
+			Eigen::MatrixX<float>::Identity(25, 25) }, smallCore);
+		const Eigen::Map<const Eigen::MatrixX<float>> spatial(spatialTensor.data(), 3 * 64 * 36, 25);
+		const Eigen::MatrixX<float> frames = spatial * expand[3].transpose();
+		EXPECT((frames - Eigen::Map<const Eigen::MatrixX<float>>(natural.data(), 3 * 64 * 36, 24)).norm()
+			< 0.0001 * natural.norm(), "fused frame product");
+		// a 2x downscaled crop from averaged rows of the spatial bases
+		const auto preview = multilinearProduct(std::array<Eigen::MatrixX<float>, 4>{ expand[0],
+			details::resampleRows(expand[1], 8, 32, 2), details::resampleRows(expand[2], 4, 20, 2), expand[3] }, smallCore);
+		const Tensor<float, 4> crop(natural.slice(1, 8, 32).slice(2, 4, 20));
+		Tensor<float, 4> previewRef(preview.size());
+		previewRef.set([&](const Tensor<float, 4>::SizeVector& _index)
+			{
+				float sum = 0.f;
+				for (int x = 0; x < 2; ++x)
+					for (int y = 0; y < 2; ++y)
+						sum += crop[{ _index[0], 2 * _index[1] + x, 2 * _index[2] + y, _index[3] }];
+				return sum / 4.f;
+			});
+		EXPECT(distance(preview, previewRef) < 0.0001 * previewRef.norm(), "downscaled region decode");
+		EXPECT(details::decodeRegion(std::nullopt, 1, 64, 36) == (std::array<int, 4>{ 0, 0, 64, 36 })
+			&& details::decodeRegion(std::array<int, 4>{ 8, 4, 33, 22 }, 2, 64, 36) == (std::array<int, 4>{ 8, 4, 32, 20 }),
+			"decode region rounded to even frames");
+		auto invalidRegion = [](const std::array<int, 4>& _region, int _downscale)
+		{
+			try
+			{
+				details::decodeRegion(_region, _downscale, 64, 36);
+			}
+			catch (const std::string&)
+			{
+				return true;
+			}
+			return false;
+		};
+		EXPECT(invalidRegion({ 60, 0, 8, 8 }, 1) && invalidRegion({ -1, 0, 8, 8 }, 1) && invalidRegion({ 0, 0, 3, 8 }, 2)
+			&& invalidRegion({ 0, 0, 8, 8 }, 0), "invalid decode region");
+	}
+	{
+		// decaying spectrum, so that truncation takes place
+		auto errorTensor = randomTensor<4>({ 3,20,15,10 });
+		errorTensor.set([&](const Tensor<float, 4>::SizeVector& _index) {
+			return errorTensor[_index] * std::exp(-0.3f * (_index[1] + _index[2] + _index[3])); });
+		const auto& [UE, CE] = hosvdInterlaced(errorTensor, truncation::RelativeError(0.1));
+		EXPECT(distance(errorTensor, multilinearProduct(UE, CE)) <= 0.1 * errorTensor.norm()
+			&& CE.numElements() < errorTensor.numElements() / 4, "relative error truncation");
+		const auto psnr = truncation::RelativeError::fromPSNR(30.0, errorTensor.expr().squaredNorm(), errorTensor.numElements());
+		const auto& [UP, CP] = hosvd(errorTensor, psnr);
+		const double mse = std::pow(distance(errorTensor, multilinearProduct(UP, CP)), 2) / errorTensor.numElements();
+		EXPECT(-10.0 * std::log10(mse) >= 30.0, "psnr truncation");
+	}
+	{
+		// a static block with a fast decaying spectrum and a block with a flat spectrum
+		std::vector<BlockSpectrum<2>> spectra(2);
+		for (auto& spectrum : spectra)
+			spectrum.size = { 10, 10 };
+		for (int k = 0; k < 2; ++k)
+		{
+			spectra[0].energy[k] = Eigen::VectorXd::LinSpaced(10, 0.0, -9.0).array().exp();
+			spectra[1].energy[k] = Eigen::VectorXd::LinSpaced(10, 1.0, 0.5);
+		}
+		const auto ranks = allocateRanks(spectra, 400, 0, 1);
+		std::size_t bytes = 0;
+		for (std::size_t b = 0; b < ranks.size(); ++b)
+			bytes += details::tuckerElements(spectra[b].size, ranks[b]);
+		EXPECT(bytes <= 400 && ranks[0][0] < ranks[1][0] && ranks[0][1] < ranks[1][1], "rate-distortion rank allocation");
+	}
+	{
+		// the incrementally built cores are not sorted by energy
+		const Video video(randomTensor<4>({ 3,24,20,12 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		auto incrementalCompressor = [&](std::size_t _maxBytes)
+		{
+			compression::HOSVDCompressor<Video::RGB> compressor{ Video::RGB() };
+			compressor.setTruncation(truncation::Rank{ 3,12,12,4 });
+			compressor.setFramesPerBlock(6);
+			compressor.setIncremental(2);
+			compressor.setMaxBytes(_maxBytes);
+			compressor.encode(video);
+			return compressor;
+		};
+		const std::string fileName = "budget_test.ten";
+		incrementalCompressor(12000).save(fileName);
+		const auto fileSize = std::ifstream(fileName, std::ios::binary | std::ios::ate).tellg();
+		std::remove(fileName.c_str());
+		EXPECT(fileSize > 0 && fileSize <= 12000, "byte budget of the saved file");
+		// sorting the slices by energy does not change the decomposition
+		const auto reference = incrementalCompressor(0).decode().asTensor();
+		EXPECT(distance(reference, incrementalCompressor(1 << 30).decode().asTensor()) < 0.01 * reference.norm(),
+			"energy sorted decomposition");
+
+	}
+	{
+		// random access frames match the full decode, also for a short last block and a region
+		const Video video(randomTensor<4>({ 3,16,12,15 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		compression::HOSVDCompressor<Video::RGB> compressor{ Video::RGB() };
+		compressor.setFramesPerBlock(6);
+		compressor.encode(video);
+		auto sameFrames = [&]()
+		{
+			const Video decoded = compressor.decode();
+			const std::size_t frameSize = 3 * decoded.getWidth() * decoded.getHeight();
+			bool same = true;
+			for (std::size_t t : { 0, 8, 14 })
+			{
+				const Video frame = compressor.decodeFrame(t);
+				same &= frame.getNumFrames() == 1 && frame.getWidth() == decoded.getWidth()
+					&& frame.getHeight() == decoded.getHeight();
+				// the products are evaluated in a different order, so allow rounding to differ
+				for (std::size_t j = 0; j < frameSize && same; ++j)
+					same &= std::abs(frame.getFrame(0)[j] - decoded.getFrame(t)[j]) <= 1;
+			}
+			return same;
+		};
+		const bool sameFull = sameFrames();
+		compressor.setRegion(2, 4, 10, 8);
+		compressor.setDownscale(2);
+		const bool sameRegion = sameFrames();
+		bool outOfRange = false;
+		try
+		{
+			compressor.decodeFrame(15);
+		}
+		catch (const std::string&)
+		{
+			outOfRange = true;
+		}
+		EXPECT(sameFull && sameRegion && outOfRange, "random access frame decode");
+	}
+	{
+		// the tiled decode of a block, here in two tiles of image rows, matches the full expansion
+		const Video video(randomTensor<4>({ 3,64,100,4 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		compression::HOSVDCompressor<Video::RGB> compressor{ Video::RGB() };
+		compressor.setTruncation(truncation::Rank{ 3,16,16,3 });
+		compressor.encode(video);
+		const Video decoded = compressor.decode();
+		const Video expanded(multilinearProduct(compressor.basis(0), compressor.singularValues()[0]),
+			Video::FrameRate{ 1,24 }, Video::RGB());
+		const std::size_t frameSize = 3 * 64 * 100;
+		bool same = decoded.getNumFrames() == 4 && expanded.getNumFrames() == 4;
+		// the products are evaluated in a different order, so allow rounding to differ
+		for (std::size_t t = 0; t < 4 && same; ++t)
+			for (std::size_t j = 0; j < frameSize && same; ++j)
+				same &= std::abs(decoded.getFrame(t)[j] - expanded.getFrame(t)[j]) <= 1;
+		EXPECT(same, "tiled block decode");
+	}
+	{
+		// without rank truncation, the mode order of a block follows the ranks of the previous one
+		const Video video(randomTensor<4>({ 3,24,20,12 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		compression::HOSVDCompressor<Video::RGB> compressor{ Video::RGB() };
+		compressor.setTruncation(truncation::RelativeError(0.3));
+		compressor.setFramesPerBlock(6);
+		compressor.encode(video);
+		std::array<int, 4> previousRanks;
+		for (int k = 0; k < 4; ++k)
+			previousRanks[k] = static_cast<int>(compressor.basis(0)[k].cols());
+		const std::array<int, 4> blockSize{ 3,24,20,6 };
+		EXPECT(compressor.modeOrders()[0] == optimalModeOrder(blockSize, blockSize)
+			&& compressor.modeOrders()[1] == optimalModeOrder(blockSize, previousRanks),
+			"mode order from the previous ranks");
+	}
+	{
+		// a file of one compressor is rejected by the other
+		const Video video(randomTensor<4>({ 3,16,12,8 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		const std::string fileName = "format_test.ten";
+		bool rejected = false;
+		std::size_t numLoaded = 0;
+		{
+			compression::TTCompressor<Video::RGB> ttCompressor{ Video::RGB() };
+			ttCompressor.setFramesPerBlock(4);
+			ttCompressor.encode(video);
+			ttCompressor.save(fileName);
+			compression::HOSVDCompressor<Video::RGB> hosvdCompressor{ Video::RGB() };
+			try
+			{
+				hosvdCompressor.load(fileName);
+			}
+			catch (const std::string&)
+			{
+				rejected = true;
+			}
+			ttCompressor.load(fileName);
+			numLoaded = ttCompressor.trains().size();
+		}
+		std::remove(fileName.c_str());
+		EXPECT(rejected && numLoaded == 2, "file format tag");
+	}
+	{
+		// a truncated file is rejected instead of being mapped past its end
+		const Video video(randomTensor<4>({ 3,16,12,8 }), Video::FrameRate{ 1,24 }, Video::RGB());
+		const std::string fileName = "truncated_test.ten";
+		compression::HOSVDCompressor<Video::RGB> compressor{ Video::RGB() };
+		compressor.setFramesPerBlock(4);
+		compressor.encode(video);
+		compressor.save(fileName);
+		std::string content;
+		{
+			std::ifstream file(fileName, std::ios::binary);
+			content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		std::ofstream(fileName, std::ios::binary).write(content.data(), content.size() / 2);
+		bool truncated = false;
+		try
+		{
+			compressor.load(fileName);
+		}
+		catch (const std::string&)
+		{
+			truncated = true;
+		}
+		std::remove(fileName.c_str());
+		EXPECT(truncated, "truncated file");
+	}
+	{
+		// two blocks with the same bases, e.g. from the same shot
+		const std::array<Eigen::MatrixX<float>, 4> shotBasis{ Eigen::MatrixX<float>::Random(3, 3),
+			Eigen::MatrixX<float>::Random(40, 4), Eigen::MatrixX<float>::Random(30, 4), Eigen::MatrixX<float>::Random(12, 3) };
+		const auto block0 = multilinearProduct(shotBasis, randomTensor<4>({ 3,4,4,3 }));
+		const auto block1 = multilinearProduct(shotBasis, randomTensor<4>({ 3,4,4,3 }));
+		const truncation::Rank rank{ 3,4,4,3 };
+		const std::array<int, 4> order{ 0,1,2,3 };
+		const auto& [U0, C0] = hosvdInterlaced(block0, rank, order);
+		WarmStartStats stats;
+		const auto& [UW, CW] = hosvdWarmStarted(block1, rank, U0, order, 1, &stats);
+		EXPECT(stats.numRefined == 3 && stats.numFallbacks == 0
+			&& distance(block1, multilinearProduct(UW, CW)) < 0.0001 * block1.norm(), "warm started hosvd");
+		// a new shot is not captured by the initial bases without iterations
+		const auto block2 = multilinearProduct(std::array<Eigen::MatrixX<float>, 4>{ Eigen::MatrixX<float>::Random(3, 3),
+			Eigen::MatrixX<float>::Random(40, 4), Eigen::MatrixX<float>::Random(30, 4), Eigen::MatrixX<float>::Random(12, 3) },
+			randomTensor<4>({ 3,4,4,3 }));
+		stats = WarmStartStats();
+		const auto& [UF, CF] = hosvdWarmStarted(block2, rank, U0, order, 0, &stats);
+		EXPECT(stats.numFallbacks == 3 && distance(block2, multilinearProduct(UF, CF)) < 0.0001 * block2.norm(), "warm start fallback");
+		// noise outside of the initial subspace counts towards the error budget; only mode 1 is warm started
+		const std::array<Eigen::MatrixX<float>, 4> tallBasis{ Eigen::MatrixX<float>::Random(3, 3),
+			Eigen::MatrixX<float>::Random(200, 4), Eigen::MatrixX<float>::Random(10, 3), Eigen::MatrixX<float>::Random(6, 3) };
+		const auto signal = multilinearProduct(tallBasis, randomTensor<4>({ 3,4,3,3 }));
+		const auto& [US, CS] = hosvdInterlaced(signal, truncation::Rank{ 3,4,3,3 }, order);
+		const float rms = signal.norm() / std::sqrt(static_cast<float>(signal.numElements()));
+		const Tensor<float, 4> noisy = signal + 0.5f * rms * (randomTensor<4>(signal.size()) - randomTensor<4>(signal.size()));
+		stats = WarmStartStats();
+		const auto& [UN, CN] = hosvdWarmStarted(noisy, truncation::RelativeError(0.14), US, order, 0, &stats);
+		EXPECT(stats.numFallbacks == 1 && distance(noisy, multilinearProduct(UN, CN)) <= 0.14 * noisy.norm(),
+			"warm started relative error");
+	}
+	{
+		EXPECT(details::quantizedModes(std::array<int, 2>{ 640, 7 }, 16) == (std::vector<int>{ 16, 8, 5, 7 }), "quantized modes");
+		const auto ttTensor = randomTensor<3>({ 12,10,6 });
+		const auto train = ttSvd(ttTensor, details::quantizedModes(ttTensor.size(), 4));
+		EXPECT(train.order() == 6 && distance(ttTensor, train.decode(ttTensor.size())) < 0.0001 * ttTensor.norm(), "tt-svd without truncation");
+		const auto truncated = ttSvd(ttTensor, truncation::Rank{ 4,4 });
+		EXPECT(truncated.ranks() == (std::vector<int>{ 4, 4 }) && truncated.numParameters() == 12 * 4 + 4 * 10 * 4 + 4 * 6, "tt-svd truncation");
+	}
+
 	const auto mediumTensor = countTensor<4>({ 16,11,7, 8 });
 	testFlattening(mediumTensor);
+	EXPECT(mediumTensor.flatten<2>() == mediumTensor.flatten(2), "compile time flattening");
+	const Eigen::MatrixX<float> flat = mediumTensor.flatten(1);
+	const Tensor<float, 4>::SizeVector elementIndex{ 3, 4, 5, 2 };
+	EXPECT(flat(4, 3 + 16 * (5 + 7 * 2)) == mediumTensor[elementIndex], "flattening layout");
+	// views
+	const auto sliced = mediumTensor.slice(1, 3, 5).slice(3, 2, 4);
+	const Tensor<float, 4> slicedCopy(sliced);
+	EXPECT(std::abs(sliced.norm() - slicedCopy.norm()) < 0.0001f * sliced.norm(), "view norm");
+	EXPECT((sliced - slicedCopy).norm() == 0.f, "view subtraction");
+	bool sameFlattening = true;
+	for (int k = 0; k < 4; ++k)
+		sameFlattening &= sliced.flatten(k) == slicedCopy.flatten(k);
+	EXPECT(sameFlattening, "view flattening");
+	const auto& [U5, C5] = hosvdInterlaced(slicedCopy);
+	EXPECT((multilinearProduct(U5, C5) - sliced).norm() / sliced.norm() < 0.0001f, "view multilinear product");
+	EXPECT((multilinearProduct(U5, sliced, true) - C5).norm() / C5.norm() < 0.0001f, "strided multilinear product");
+
+	// reduced precision storage; the counts are exactly representable as half
+	const auto exactTensor = countTensor<4>({ 4,5,6,3 });
+	Tensor<Eigen::half, 4> halfTensor(exactTensor.size());
+	details::convertCopy(exactTensor.data(), exactTensor.data() + exactTensor.numElements(), halfTensor.data());
+	EXPECT(halfTensor.flatten(2) == exactTensor.flatten(2), "reduced precision flattening");
+	const auto& [U6, C6] = hosvdInterlaced(halfTensor);
+	EXPECT((exactTensor - multilinearProduct(U6, C6)).norm() / exactTensor.norm() < 0.0001f, "reduced precision hosvd");
+
+	// thread shares of concurrent modes
+	{
+		const auto threads = details::apportionThreads(std::array<double, 4>{ 1.0, 1.0, 1.0, 100.0 }, 6);
+		EXPECT(threads == (std::array<int, 4>{ 1, 1, 1, 3 }), "thread shares within the budget");
+		EXPECT(details::apportionThreads(std::array<double, 4>{ 1.0, 2.0, 3.0, 4.0 }, 2) == (std::array<int, 4>{ 1, 1, 1, 1 }),
+			"one thread per mode without budget");
+		const auto split = details::apportionThreads(std::array<double, 3>{ 1.0, 1.0, 1.0 }, 8);
+		EXPECT(split[0] + split[1] + split[2] == 8 && *std::min_element(split.begin(), split.end()) == 2,
+			"largest remainder thread shares");
+	}
+	// more threads than modes
+	const int maxThreads = omp_get_max_threads();
+	const int maxActiveLevels = omp_get_max_active_levels();
+	omp_set_num_threads(6);
+	const auto& [U7, C7] = hosvd(mediumTensor, truncation::Rank{ 16,11,7,8 });
+	omp_set_num_threads(maxThreads);
+	EXPECT(omp_get_max_active_levels() == maxActiveLevels, "concurrent hosvd restores the nesting");
+	EXPECT((mediumTensor - multilinearProduct(U7, C7)).norm() / mediumTensor.norm() < 0.0001f, "concurrent hosvd");
+
 	const auto& [U3, C3] = hosvdInterlaced(mediumTensor);
 	auto tensor4 = multilinearProduct(U3, C3);
 	EXPECT((mediumTensor - tensor4).norm() / mediumTensor.norm() < 0.0001f, "interlaced hosvd");
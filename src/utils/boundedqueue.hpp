@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Thread-safe FIFO queue with a maximum number of elements for producer-consumer pipelines.
+// A full queue blocks the producer, so that it cannot run arbitrarily far ahead.
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(std::size_t _capacity) : m_capacity(_capacity), m_closed(false) {}
+
+	// Waits until there is space for _value.
+	// @return False if the queue was closed; _value is then discarded.
+	bool push(T _value)
+	{
+		std::unique_lock lock(m_mutex);
+		m_notFull.wait(lock, [this]() { return m_closed || m_queue.size() < m_capacity; });
+		if (m_closed)
+			return false;
+		m_queue.push_back(std::move(_value));
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+	// Waits until an element is available.
+	// @return Nothing if the queue is closed and empty.
+	std::optional<T> pop()
+	{
+		std::unique_lock lock(m_mutex);
+		m_notEmpty.wait(lock, [this]() { return m_closed || !m_queue.empty(); });
+		if (m_queue.empty())
+			return std::nullopt;
+		T value = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_notFull.notify_one();
+		return value;
+	}
+
+	// No more elements can be pushed; remaining elements can still be popped.
+	void close()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_closed = true;
+		}
+		m_notFull.notify_all();
+		m_notEmpty.notify_all();
+	}
+private:
+	std::size_t m_capacity;
+	bool m_closed;
+	std::deque<T> m_queue;
+	std::mutex m_mutex;
+	std::condition_variable m_notFull;
+	std::condition_variable m_notEmpty;
+};
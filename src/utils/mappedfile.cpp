@@ -0,0 +1,71 @@
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& _fileName)
+	: m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+	m_file = CreateFileA(_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size;
+	if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+		throw std::string("Could not open file " + _fileName + ".");
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	if (!m_size)
+		return;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (m_mapping)
+		m_data = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+	if (!m_data)
+	{
+		if (m_mapping) CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::string("Could not map file " + _fileName + ".");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::string& _fileName)
+	: m_data(nullptr), m_size(0)
+{
+	const int file = open(_fileName.c_str(), O_RDONLY);
+	struct stat status;
+	if (file == -1 || fstat(file, &status) == -1)
+	{
+		if (file != -1) close(file);
+		throw std::string("Could not open file " + _fileName + ".");
+	}
+	m_size = static_cast<std::size_t>(status.st_size);
+	if (m_size)
+	{
+		void* ptr = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (ptr != MAP_FAILED)
+			m_data = static_cast<char*>(ptr);
+	}
+	// the mapping stays valid without the descriptor
+	close(file);
+	if (m_size && !m_data)
+		throw std::string("Could not map file " + _fileName + ".");
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data) munmap(m_data, m_size);
+}
+#endif
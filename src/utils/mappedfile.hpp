@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Maps a whole file into memory so that its content is only read when it is accessed.
+// The mapping is copy-on-write: the memory may be modified without changing the file.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& _fileName);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	char* data() const noexcept { return m_data; }
+	std::size_t size() const noexcept { return m_size; }
+private:
+	char* m_data;
+	std::size_t m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+};
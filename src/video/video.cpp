@@ -1,6 +1,7 @@
 #include "video.hpp"
 #include "ffmpegutils.hpp"
 #include "frameconverter.hpp"
+#include "videowriter.hpp"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb/stb_image_write.h>
@@ -34,6 +35,34 @@ Video::Video(const FrameTensor& _tensor, FrameRate _frameRate)
 	}
 }
 
+Video::Video(int _width, int _height, FrameRate _frameRate)
+	: m_width(_width),
+	m_height(_height),
+	m_frameSize(_width * _height * 3),
+	m_frameRate(_frameRate)
+{
+}
+
+void Video::addFrames(size_t _count)
+{
+	for (size_t i = 0; i < _count; ++i)
+		m_frames.emplace_back(new unsigned char[m_frameSize]);
+}
+
+void Video::quantizeTile(const Eigen::Ref<const Eigen::MatrixX<float>>& _spatial,
+	const Eigen::Ref<const Eigen::MatrixX<float>>& _temporal, size_t _firstFrame, std::ptrdiff_t _offset)
+{
+	// one tile of every frame
+	const Eigen::MatrixX<float> tile = _spatial * _temporal.transpose();
+	for (Eigen::Index i = 0; i < tile.cols(); ++i)
+	{
+		unsigned char* dst = m_frames[_firstFrame + i].get() + _offset;
+		const float* src = tile.col(i).data();
+		for (Eigen::Index j = 0; j < tile.rows(); ++j)
+			dst[j] = static_cast<unsigned char>(std::clamp(src[j], 0.f, 1.f) * 255.f);
+	}
+}
+
 // *************************************************************** //
 Tensor<float, 3> Video::SingleChannel::operator()(const Video& _video, 
 	int _firstFrame, int _numFrames) const
@@ -55,18 +84,19 @@ Tensor<float, 3> Video::SingleChannel::operator()(const Video& _video,
 	return tensor;
 }
 
-Tensor<float, 4> Video::RGB::toTensor(const Video& _video,
+template<typename Scalar>
+Tensor<Scalar, 4> Video::RGB::toTensor(const Video& _video,
 	int _firstFrame, int _numFrames) const
 {
-	TensorType tensor({ 3, _video.m_width, _video.m_height, _numFrames });
+	Tensor<Scalar, 4> tensor({ 3, _video.m_width, _video.m_height, _numFrames });
 
-	float* ptr = tensor.data();
+	Scalar* ptr = tensor.data();
 	int count = 0;
 	for (int i = _firstFrame; i < _firstFrame + _numFrames; ++i)
 	{
 		for (int j = 0; j < _video.m_frameSize; ++j)
 		{
-			*ptr = static_cast<float>(_video.m_frames[i][j]) / 255.f;
+			*ptr = static_cast<Scalar>(static_cast<float>(_video.m_frames[i][j]) / 255.f);
 			++ptr;
 			++count;
 		}
@@ -75,32 +105,33 @@ Tensor<float, 4> Video::RGB::toTensor(const Video& _video,
 	return tensor;
 }
 
-void Video::RGB::fromTensor(const TensorType& _tensor, Video& _video) const
+void Video::RGB::fromTensor(const TensorView<const float, 4>& _tensor, Video& _video) const
 {
-	Tensor<float, 4>::SizeVector sizeVector{};
-	sizeVector.back() = 1;
-	const size_t frameOffset = _tensor.flatIndex(sizeVector);
+	const std::ptrdiff_t channelStride = _tensor.strides()[0];
 	for (int i = 0; i < _tensor.size().back(); ++i)
 	{
 		_video.m_frames.emplace_back(new unsigned char[_video.m_frameSize] {});
-		const float* begin = _tensor.data() + i * frameOffset;
-		for (int j = 0; j < _video.m_frameSize; ++j)
-		{
-			_video.m_frames.back()[j] = static_cast<unsigned char>(std::clamp(*begin, 0.f, 1.f) * 255.f);
-			++begin;
-		}
+		unsigned char* dst = _video.m_frames.back().get();
+		const auto frame = _tensor.slice(3, i);
+		details::forEachFiber(frame.size(), [&](const Tensor<float, 4>::SizeVector& _index)
+			{
+				const float* pixel = frame.data() + frame.offset(_index);
+				for (int c = 0; c < frame.size()[0]; ++c)
+					*dst++ = static_cast<unsigned char>(std::clamp(pixel[c * channelStride], 0.f, 1.f) * 255.f);
+			});
 	}
 }
 
-Tensor<float, 4> Video::YUV444::toTensor(const Video& _video,
+template<typename Scalar>
+Tensor<Scalar, 4> Video::YUV444::toTensor(const Video& _video,
 	int _firstFrame, int _numFrames) const
 {
-	TensorType tensor({ 3, _video.m_width, _video.m_height, _numFrames });
+	Tensor<Scalar, 4> tensor({ 3, _video.m_width, _video.m_height, _numFrames });
 
 	FrameConverter converter(_video.m_width, _video.m_height,
 		AVPixelFormat::AV_PIX_FMT_RGB24, AVPixelFormat::AV_PIX_FMT_YUV444P);
 
-	float* ptr = tensor.data();
+	Scalar* ptr = tensor.data();
 	for (int i = _firstFrame; i < _firstFrame + _numFrames; ++i)
 	{
 		const unsigned char* begin = _video.m_frames[i].get();
@@ -108,39 +139,67 @@ Tensor<float, 4> Video::YUV444::toTensor(const Video& _video,
 		converter.convert();
 		for (int j = 0; j < _video.m_width*_video.m_height; ++j)
 		{
-			*ptr++ = static_cast<float>(converter.getDstFrame().data[0][j]) / 255.f;
-			*ptr++ = static_cast<float>(converter.getDstFrame().data[1][j]) / 255.f;
-			*ptr++ = static_cast<float>(converter.getDstFrame().data[2][j]) / 255.f;
+			*ptr++ = static_cast<Scalar>(static_cast<float>(converter.getDstFrame().data[0][j]) / 255.f);
+			*ptr++ = static_cast<Scalar>(static_cast<float>(converter.getDstFrame().data[1][j]) / 255.f);
+			*ptr++ = static_cast<Scalar>(static_cast<float>(converter.getDstFrame().data[2][j]) / 255.f);
 		}
 	}
 
 	return tensor;
 }
 
-void Video::YUV444::fromTensor(const TensorType& _tensor, Video& _video) const
+template Tensor<float, 4> Video::RGB::toTensor<float>(const Video&, int, int) const;
+template Tensor<Eigen::half, 4> Video::RGB::toTensor<Eigen::half>(const Video&, int, int) const;
+template Tensor<Eigen::bfloat16, 4> Video::RGB::toTensor<Eigen::bfloat16>(const Video&, int, int) const;
+template Tensor<float, 4> Video::YUV444::toTensor<float>(const Video&, int, int) const;
+template Tensor<Eigen::half, 4> Video::YUV444::toTensor<Eigen::half>(const Video&, int, int) const;
+template Tensor<Eigen::bfloat16, 4> Video::YUV444::toTensor<Eigen::bfloat16>(const Video&, int, int) const;
+
+void Video::YUV444::fromTensor(const TensorView<const float, 4>& _tensor, Video& _video) const
 {
 	FrameConverter converter(_video.m_width, _video.m_height,
 		AVPixelFormat::AV_PIX_FMT_YUV444P, AVPixelFormat::AV_PIX_FMT_RGB24);
 
-	Tensor<float, 4>::SizeVector sizeVector{};
-	sizeVector.back() = 1;
-	const size_t frameOffset = _tensor.flatIndex(sizeVector);
+	const std::ptrdiff_t channelStride = _tensor.strides()[0];
 	for (int i = 0; i < _tensor.size().back(); ++i)
 	{
-		const float* current = _tensor.data() + i * frameOffset;
-		for (int j = 0; j < _video.m_frameSize/3; ++j)
-		{
-			AVFrame& frame = converter.getSrcFrame();
-			frame.data[0][j] = static_cast<unsigned char>(std::clamp(*current++, 0.f, 1.f) * 255.f);
-			frame.data[1][j] = static_cast<unsigned char>(std::clamp(*current++, 0.f, 1.f) * 255.f);
-			frame.data[2][j] = static_cast<unsigned char>(std::clamp(*current++, 0.f, 1.f) * 255.f);
-		}
+		AVFrame& frame = converter.getSrcFrame();
+		const auto frameView = _tensor.slice(3, i);
+		int j = 0;
+		details::forEachFiber(frameView.size(), [&](const Tensor<float, 4>::SizeVector& _index)
+			{
+				const float* current = frameView.data() + frameView.offset(_index);
+				frame.data[0][j] = static_cast<unsigned char>(std::clamp(current[0], 0.f, 1.f) * 255.f);
+				frame.data[1][j] = static_cast<unsigned char>(std::clamp(current[channelStride], 0.f, 1.f) * 255.f);
+				frame.data[2][j] = static_cast<unsigned char>(std::clamp(current[2 * channelStride], 0.f, 1.f) * 255.f);
+				++j;
+			});
 		converter.convert();
 		_video.m_frames.emplace_back(new unsigned char[_video.m_frameSize]);
 		std::copy(converter.getDstFrame().data[0], converter.getDstFrame().data[0] + _video.m_frameSize, _video.m_frames.back().get());
 	}
 }
 
+void Video::YUV444::toRGB(Video& _video, size_t _firstFrame) const
+{
+	FrameConverter converter(_video.m_width, _video.m_height,
+		AVPixelFormat::AV_PIX_FMT_YUV444P, AVPixelFormat::AV_PIX_FMT_RGB24);
+
+	for (size_t i = _firstFrame; i < _video.m_frames.size(); ++i)
+	{
+		AVFrame& frame = converter.getSrcFrame();
+		const unsigned char* src = _video.m_frames[i].get();
+		for (int j = 0; j < _video.m_width * _video.m_height; ++j)
+		{
+			frame.data[0][j] = *src++;
+			frame.data[1][j] = *src++;
+			frame.data[2][j] = *src++;
+		}
+		converter.convert();
+		std::copy(converter.getDstFrame().data[0], converter.getDstFrame().data[0] + _video.m_frameSize, _video.m_frames[i].get());
+	}
+}
+
 Video::YUV420::TensorType Video::YUV420::toTensor(const Video& _video,
 	int _firstFrame, int _numFrames) const
 {
@@ -214,86 +273,9 @@ void Video::saveFrame(const std::string& _fileName, int _frame) const
 
 void Video::save(const std::string& _fileName) const
 {
-	constexpr AVPixelFormat outFormat = AVPixelFormat::AV_PIX_FMT_YUV420P;
-
-	AVFormatContext* ofctxTemp;
-	AVCALL(avformat_alloc_output_context2, &ofctxTemp, nullptr, nullptr, _fileName.c_str());
-	std::unique_ptr<AVFormatContext> ofctx(ofctxTemp);
-
-	// select codec
-/*	const std::filesystem::path filePath = _fileName;
-	std::string codecName = "libx264";
-	if (filePath.extension() == ".avi")
-		codecName = "ffv1";*/
-
-	
-	AVCodec* codec = AVCALLRET(avcodec_find_encoder_by_name,"ffv1");
-	AVStream* videoStream = AVCALLRET(avformat_new_stream, ofctx.get(), codec);
-
-	std::unique_ptr<AVCodecContext> cctx(AVCALLRET(avcodec_alloc_context3, codec));
-
-	videoStream->codecpar->codec_id = codec->id;
-	videoStream->codecpar->codec_type = AVMediaType::AVMEDIA_TYPE_VIDEO;
-	videoStream->codecpar->width = m_width;
-	videoStream->codecpar->height = m_height;
-	videoStream->codecpar->format = outFormat;
-//	videoStream->codecpar->bit_rate = 10000;
-	videoStream->time_base = { m_frameRate.num, m_frameRate.den };
-
-	avcodec_parameters_to_context(cctx.get(), videoStream->codecpar);
-	cctx->time_base = videoStream->time_base;
-//	cctx->max_b_frames = 2;
-//	cctx->gop_size = 12;
-/*	if (videoStream->codecpar->codec_id == AV_CODEC_ID_H264) {
-		av_opt_set(cctx, "preset", "ultrafast", 0);
-	}*/
-	avcodec_parameters_from_context(videoStream->codecpar, cctx.get());
-
-	AVCALL(avcodec_open2, cctx.get(), codec, NULL);
-	AVCALL(avio_open, &ofctx->pb, _fileName.c_str(), AVIO_FLAG_WRITE);
-	AVCALL(avformat_write_header, ofctx.get(), NULL);
-
-	av_dump_format(ofctx.get(), 0, _fileName.c_str(), 1);
-
-	FrameConverter converter(cctx->width, cctx->height, AV_PIX_FMT_RGB24, outFormat);
-
-	int count = 0;
-	AVPacket pkt;
-	av_init_packet(&pkt);
-	pkt.data = NULL;
-	pkt.size = 0;
-	for (auto& frame : m_frames)
-	{
-		const unsigned char* begin = frame.get();
-		std::copy(begin, begin + m_frameSize, converter.getSrcFrame().data[0]);
-	//	const int inLinesize[1] = { 3 * cctx->width };
-		converter.convert();
-		converter.getDstFrame().pts = ++count;
-		avcodec_send_frame(cctx.get(), &converter.getDstFrame());
-
-		if (avcodec_receive_packet(cctx.get(), &pkt) == 0) 
-		{
-		//	pkt.flags |= AV_PKT_FLAG_KEY;
-			av_interleaved_write_frame(ofctx.get(), &pkt);
-			av_packet_unref(&pkt);
-		}
-	}
-
-	for (;;) 
-	{
-		avcodec_send_frame(cctx.get(), NULL);
-		if (avcodec_receive_packet(cctx.get(), &pkt) == 0) 
-		{
-			av_interleaved_write_frame(ofctx.get(), &pkt);
-			av_packet_unref(&pkt);
-		}
-		else 
-		{
-			break;
-		}
-	}
-
-	av_write_trailer(ofctx.get());
+	VideoWriter writer(_fileName, m_width, m_height, m_frameRate);
+	writer.write(*this);
+	writer.close();
 }
 
 void Video::decode(const std::string& _url)
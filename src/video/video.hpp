@@ -19,8 +19,10 @@ public:
 
 	explicit Video(const std::string& _fileName);
 	Video(const FrameTensor& _tensor, FrameRate _frameRate);
+	// Creates a video without frames; frames with 3 channels can be appended.
+	Video(int _width, int _height, FrameRate _frameRate);
 	template<typename Format, int Order>
-	Video(const Tensor<float, Order>& _tensor, FrameRate _frameRate, Format _format)
+	Video(const TensorView<const float, Order>& _tensor, FrameRate _frameRate, Format _format)
 		: m_width(_tensor.size()[1]),
 		m_height(_tensor.size()[2]),
 		m_frameSize(_tensor.size()[0] * _tensor.size()[1] * _tensor.size()[2]),
@@ -28,6 +30,50 @@ public:
 	{
 		_format.fromTensor(_tensor, *this);
 	}
+	template<typename Format, int Order>
+	Video(const Tensor<float, Order>& _tensor, FrameRate _frameRate, Format _format)
+		: Video(_tensor.view(), _frameRate, _format)
+	{}
+	// Adds the frames of _tensor to the end of the video.
+	template<typename Format, int Order>
+	void append(const TensorView<const float, Order>& _tensor, Format _format)
+	{
+		if (_tensor.size()[1] != m_width || _tensor.size()[2] != m_height)
+			throw std::string("Incompatible frame sizes.");
+		_format.fromTensor(_tensor, *this);
+	}
+	template<typename Format, int Order>
+	void append(const Tensor<float, Order>& _tensor, Format _format)
+	{
+		append(_tensor.view(), _format);
+	}
+	// Adds the frames _spatial * _temporal^T to the end of the video, where row j of _spatial
+	// belongs to element j of a (3 x width x height) frame tensor in the given format.
+	// _spatialRows(y, n) returns the rows of _spatial for the image rows [y, y+n) as a column-major
+	// (3 * width * n) x _temporal.cols() tensor or matrix. The tiles are requested with at most
+	// _rowsPerTile image rows each and quantized directly into the frames, so neither the frames
+	// nor the full _spatial are ever stored as floats.
+	template<typename Format, typename SpatialRows>
+	void appendProduct(int _rowsPerTile, SpatialRows _spatialRows,
+		const Eigen::Ref<const Eigen::MatrixX<float>>& _temporal, Format _format)
+	{
+		if (_rowsPerTile < 1)
+			throw std::string("Invalid tile size.");
+		const size_t firstFrame = m_frames.size();
+		addFrames(static_cast<size_t>(_temporal.rows()));
+		const std::ptrdiff_t rowSize = m_frameSize / m_height;
+		const int numTiles = (m_height + _rowsPerTile - 1) / _rowsPerTile;
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < numTiles; ++i)
+		{
+			const int y = i * _rowsPerTile;
+			const int n = std::min(_rowsPerTile, m_height - y);
+			const auto tile = _spatialRows(y, n);
+			quantizeTile(Eigen::Map<const Eigen::MatrixX<float>>(tile.data(), n * rowSize, _temporal.cols()),
+				_temporal, firstFrame, y * rowSize);
+		}
+		_format.toRGB(*this, firstFrame);
+	}
 	template<typename... Args, typename Format>
 	Video(const std::tuple<Args...>& _tensors, FrameRate _frameRate, Format _format)
 		: m_width(std::get<0>(_tensors).size()[std::get<0>(_tensors).order() - 3]),
@@ -52,8 +98,12 @@ public:
 	struct RGB
 	{
 		using TensorType = Tensor<float, 4>;
-		TensorType toTensor(const Video&, int _firstFrame, int _numFrames) const;
-		void fromTensor(const TensorType& _tensor, Video& _video) const;
+		// @param Scalar Storage type of the tensor; Eigen::half or Eigen::bfloat16 halve the size.
+		template<typename Scalar = float>
+		Tensor<Scalar, 4> toTensor(const Video&, int _firstFrame, int _numFrames) const;
+		void fromTensor(const TensorView<const float, 4>& _tensor, Video& _video) const;
+		// Frames from _firstFrame on are already RGB.
+		void toRGB(Video&, size_t) const {}
 	};
 	struct SingleChannel
 	{
@@ -67,8 +117,12 @@ public:
 	struct YUV444
 	{
 		using TensorType = Tensor<float, 4>;
-		TensorType toTensor(const Video&, int _firstFrame, int _numFrames) const;
-		void fromTensor(const TensorType& _tensor, Video& _video) const;
+		// @param Scalar Storage type of the tensor; Eigen::half or Eigen::bfloat16 halve the size.
+		template<typename Scalar = float>
+		Tensor<Scalar, 4> toTensor(const Video&, int _firstFrame, int _numFrames) const;
+		void fromTensor(const TensorView<const float, 4>& _tensor, Video& _video) const;
+		// Converts the frames from _firstFrame on, stored as interleaved YUV, to RGB in place.
+		void toRGB(Video& _video, size_t _firstFrame) const;
 	};
 
 	struct YUV420
@@ -78,17 +132,23 @@ public:
 		void fromTensor(const TensorType& _tensor, Video& _video) const;
 	};
 	// Creates a tensor from this video, converting color information to floats in [0,1].
-	template<typename Format>
+	// @param Scalar Storage type of the tensor, if supported by the Format.
+	template<typename Scalar = float, typename Format = RGB>
 	auto asTensor(size_t _firstFrame = 0, size_t _numFrames = 0xfffffff,
 		const Format& _format = RGB()) const
 	{
 		_numFrames = std::min(_numFrames, m_frames.size() - _firstFrame);
-		return _format.toTensor(*this, static_cast<int>(_firstFrame), static_cast<int>(_numFrames));
+		if constexpr (std::is_same_v<Scalar, float>)
+			return _format.toTensor(*this, static_cast<int>(_firstFrame), static_cast<int>(_numFrames));
+		else
+			return _format.template toTensor<Scalar>(*this, static_cast<int>(_firstFrame), static_cast<int>(_numFrames));
 	}
 	FrameRate getFrameRate() const { return m_frameRate; }
 	int getWidth() const { return m_width; }
 	int getHeight() const { return m_height; }
 	size_t getNumFrames() const { return m_frames.size(); }
+	// RGB pixels of a frame
+	const unsigned char* getFrame(size_t _frame) const { return m_frames[_frame].get(); }
 
 	// save as lossless video
 	void save(const std::string& _fileName) const;
@@ -96,6 +156,12 @@ public:
 	void saveFrame(const std::string& _fileName, int _frame) const;
 private:
 	void decode(const std::string& _url);
+	// Appends _count uninitialized frames.
+	void addFrames(size_t _count);
+	// Writes _spatial * _temporal^T clamped to [0,1] and quantized to bytes into the frames
+	// starting at _firstFrame, where _spatial covers the bytes [_offset, _offset + _spatial.rows()).
+	void quantizeTile(const Eigen::Ref<const Eigen::MatrixX<float>>& _spatial,
+		const Eigen::Ref<const Eigen::MatrixX<float>>& _temporal, size_t _firstFrame, std::ptrdiff_t _offset);
 
 	int m_width;
 	int m_height;
@@ -0,0 +1,98 @@
+#include "videowriter.hpp"
+#include "ffmpegutils.hpp"
+#include "frameconverter.hpp"
+
+struct VideoWriter::Impl
+{
+	std::unique_ptr<AVFormatContext> formatContext;
+	std::unique_ptr<AVCodecContext> codecContext;
+	std::unique_ptr<FrameConverter> converter;
+	AVPacket packet;
+	int frameSize = 0;
+	int count = 0;
+
+	// Passes all packets the encoder has ready to the container.
+	void receivePackets()
+	{
+		while (avcodec_receive_packet(codecContext.get(), &packet) == 0)
+		{
+			av_interleaved_write_frame(formatContext.get(), &packet);
+			av_packet_unref(&packet);
+		}
+	}
+};
+
+VideoWriter::VideoWriter(const std::string& _fileName, int _width, int _height, Video::FrameRate _frameRate)
+	: m_impl(new Impl)
+{
+	constexpr AVPixelFormat outFormat = AVPixelFormat::AV_PIX_FMT_YUV420P;
+
+	AVFormatContext* ofctxTemp;
+	AVCALL(avformat_alloc_output_context2, &ofctxTemp, nullptr, nullptr, _fileName.c_str());
+	m_impl->formatContext.reset(ofctxTemp);
+
+	AVCodec* codec = AVCALLRET(avcodec_find_encoder_by_name, "ffv1");
+	AVStream* videoStream = AVCALLRET(avformat_new_stream, m_impl->formatContext.get(), codec);
+
+	m_impl->codecContext.reset(AVCALLRET(avcodec_alloc_context3, codec));
+	AVCodecContext* cctx = m_impl->codecContext.get();
+
+	videoStream->codecpar->codec_id = codec->id;
+	videoStream->codecpar->codec_type = AVMediaType::AVMEDIA_TYPE_VIDEO;
+	videoStream->codecpar->width = _width;
+	videoStream->codecpar->height = _height;
+	videoStream->codecpar->format = outFormat;
+	videoStream->time_base = { _frameRate.num, _frameRate.den };
+
+	avcodec_parameters_to_context(cctx, videoStream->codecpar);
+	cctx->time_base = videoStream->time_base;
+	avcodec_parameters_from_context(videoStream->codecpar, cctx);
+
+	AVCALL(avcodec_open2, cctx, codec, NULL);
+	AVCALL(avio_open, &m_impl->formatContext->pb, _fileName.c_str(), AVIO_FLAG_WRITE);
+	AVCALL(avformat_write_header, m_impl->formatContext.get(), NULL);
+
+	av_dump_format(m_impl->formatContext.get(), 0, _fileName.c_str(), 1);
+
+	m_impl->converter = std::make_unique<FrameConverter>(cctx->width, cctx->height, AV_PIX_FMT_RGB24, outFormat);
+	m_impl->frameSize = 3 * _width * _height;
+
+	av_init_packet(&m_impl->packet);
+	m_impl->packet.data = NULL;
+	m_impl->packet.size = 0;
+}
+
+VideoWriter::~VideoWriter()
+{
+	if (m_impl->codecContext)
+		avio_closep(&m_impl->formatContext->pb);
+}
+
+void VideoWriter::write(const unsigned char* _frame)
+{
+	FrameConverter& converter = *m_impl->converter;
+	std::copy(_frame, _frame + m_impl->frameSize, converter.getSrcFrame().data[0]);
+	converter.convert();
+	converter.getDstFrame().pts = ++m_impl->count;
+	avcodec_send_frame(m_impl->codecContext.get(), &converter.getDstFrame());
+	m_impl->receivePackets();
+}
+
+void VideoWriter::write(const Video& _video)
+{
+	for (size_t i = 0; i < _video.getNumFrames(); ++i)
+		write(_video.getFrame(i));
+}
+
+void VideoWriter::close()
+{
+	if (!m_impl->codecContext)
+		return;
+
+	// drain the encoder
+	avcodec_send_frame(m_impl->codecContext.get(), NULL);
+	m_impl->receivePackets();
+	av_write_trailer(m_impl->formatContext.get());
+	avio_closep(&m_impl->formatContext->pb);
+	m_impl->codecContext.reset();
+}
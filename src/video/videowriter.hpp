@@ -0,0 +1,28 @@
+#pragma once
+
+#include "video.hpp"
+#include <memory>
+#include <string>
+
+// Encodes frames into a lossless video file as they are written,
+// so that a video does not have to be kept in memory as a whole.
+class VideoWriter
+{
+public:
+	VideoWriter(const std::string& _fileName, int _width, int _height, Video::FrameRate _frameRate);
+	// Without a previous close(), the file is left unfinished, e.g. to be removed after an error.
+	~VideoWriter();
+
+	VideoWriter(const VideoWriter&) = delete;
+	VideoWriter& operator=(const VideoWriter&) = delete;
+
+	// @param _frame RGB pixels of size 3 * width * height.
+	void write(const unsigned char* _frame);
+	// Writes all frames of _video.
+	void write(const Video& _video);
+	// Flushes the encoder and finishes the file.
+	void close();
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};